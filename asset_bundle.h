@@ -0,0 +1,170 @@
+// Packed asset bundle of the ATC window: the background, runway and aircraft
+// images, the font and the music in one file beside the binary (module3
+// --pack-assets writes it).
+//
+// A bundle is a header, a table of named entries, then the files' bytes, each
+// starting on a 16-byte boundary. It is memory-mapped read-only and never copied:
+// a lookup returns a pointer into the mapping, which SFML decodes from or streams
+// directly, so the mapping must outlive every object loaded from it.
+#ifndef ASSET_BUNDLE_H
+#define ASSET_BUNDLE_H
+
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+const uint32_t ASSET_BUNDLE_MAGIC = 0x41435441;   // "ATCA"
+const uint16_t ASSET_BUNDLE_VERSION = 1;
+
+struct AssetBundleHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+};
+
+struct AssetEntry {
+    char name[48];
+    uint64_t offset;                    // from the start of the file
+    uint64_t size;
+};
+
+static_assert(sizeof(AssetBundleHeader) == 8, "AssetBundleHeader layout");
+static_assert(sizeof(AssetEntry) == 64, "AssetEntry layout");
+
+// Directory of the running binary, with a trailing slash; "" if it cannot be found
+inline std::string executableDir() {
+    char path[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (n <= 0) return "";
+    path[n] = '\0';
+    char *slash = strrchr(path, '/');
+    if (!slash) return "";
+    slash[1] = '\0';
+    return path;
+}
+
+class AssetBundle {
+public:
+    ~AssetBundle() { close(); }
+
+    // False if the file is missing or is not a bundle of this version
+    bool open(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) return false;
+        struct stat st;
+        if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(AssetBundleHeader)) {
+            ::close(fd);
+            return false;
+        }
+        size = st.st_size;
+        void *base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) return false;
+        data = static_cast<const char *>(base);
+
+        const AssetBundleHeader *h = reinterpret_cast<const AssetBundleHeader *>(data);
+        bool ok = h->magic == ASSET_BUNDLE_MAGIC && h->version == ASSET_BUNDLE_VERSION &&
+                  sizeof(AssetBundleHeader) + (size_t)h->count * sizeof(AssetEntry) <= size;
+        for (uint16_t i = 0; ok && i < h->count; i++) {
+            const AssetEntry &e = entries()[i];
+            ok = e.offset <= size && e.size <= size - e.offset && memchr(e.name, '\0', sizeof(e.name));
+        }
+        if (!ok) {
+            close();
+            return false;
+        }
+        count = h->count;
+        return true;
+    }
+
+    void close() {
+        if (data) munmap(const_cast<char *>(data), size);
+        data = nullptr;
+        count = 0;
+    }
+
+    bool isOpen() const { return data != nullptr; }
+
+    // Bytes of the named asset inside the mapping; false if the bundle has no such entry
+    bool find(const char *name, const void *&bytes, size_t &length) const {
+        for (size_t i = 0; i < count; i++) {
+            if (strcmp(entries()[i].name, name) != 0) continue;
+            bytes = data + entries()[i].offset;
+            length = entries()[i].size;
+            return true;
+        }
+        return false;
+    }
+
+    // Write the named files of dir into a bundle at path, replacing it only once
+    // the whole bundle is written. False (with errno set) if a file cannot be read
+    // or its name does not fit an entry.
+    static bool pack(const std::string &path, const std::string &dir, const std::vector<std::string> &names) {
+        std::vector<std::string> contents;
+        std::vector<AssetEntry> table(names.size());
+        uint64_t offset = sizeof(AssetBundleHeader) + names.size() * sizeof(AssetEntry);
+        for (size_t i = 0; i < names.size(); i++) {
+            if (names[i].size() >= sizeof(table[i].name)) {
+                errno = ENAMETOOLONG;
+                return false;
+            }
+            std::string bytes;
+            if (!readFile(dir + names[i], bytes)) return false;
+            offset = (offset + 15) & ~15ULL;
+            memset(&table[i], 0, sizeof(table[i]));
+            memcpy(table[i].name, names[i].c_str(), names[i].size());
+            table[i].offset = offset;
+            table[i].size = bytes.size();
+            offset += bytes.size();
+            contents.push_back(std::move(bytes));
+        }
+
+        std::string tmp = path + ".tmp";
+        FILE *out = fopen(tmp.c_str(), "wb");
+        if (!out) return false;
+        AssetBundleHeader header = {ASSET_BUNDLE_MAGIC, ASSET_BUNDLE_VERSION, (uint16_t)names.size()};
+        bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                  fwrite(table.data(), sizeof(AssetEntry), table.size(), out) == table.size();
+        static const char padding[16] = {};
+        for (size_t i = 0; ok && i < contents.size(); i++) {
+            size_t gap = (size_t)(table[i].offset - ftell(out));
+            ok = fwrite(padding, 1, gap, out) == gap &&
+                 fwrite(contents[i].data(), 1, contents[i].size(), out) == contents[i].size();
+        }
+        if (fclose(out) != 0 || !ok || rename(tmp.c_str(), path.c_str()) != 0) {
+            remove(tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+    size_t count = 0;
+
+    const AssetEntry *entries() const {
+        return reinterpret_cast<const AssetEntry *>(data + sizeof(AssetBundleHeader));
+    }
+
+    static bool readFile(const std::string &path, std::string &bytes) {
+        FILE *in = fopen(path.c_str(), "rb");
+        if (!in) return false;
+        char buffer[65536];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) bytes.append(buffer, n);
+        bool ok = !ferror(in);
+        fclose(in);
+        return ok;
+    }
+};
+
+#endif
@@ -6,10 +6,17 @@
 #include <vector>
 #include <sys/stat.h>
 #include <errno.h>
+#include <limits.h>   // PIPE_BUF
 #include <mutex>
 #include <thread>
 #include <signal.h>
 #include <atomic>  // [new added]
+#include <string>
+#include <algorithm>
+#include "avn_protocol.h"
+#include "avn_ring.h"
+#include "latency_histogram.h"
+#include "metrics.h"
 
 using namespace std;
 
@@ -25,32 +32,55 @@ std::mutex avnMutex;
 // [new added] Atomic flag to signal threads to exit
 std::atomic<bool> exitRequested(false);
 
-// Structure for AVN
-struct AVN {
-    char avnId[20];
-    char flightName[30];
-    char airline[30];
-    int aircraftType;
-    int recordedSpeed;
-    int permissibleSpeed;
-    time_t issueTime;
-    double fineAmount;
-    bool isPaid;
+// AVNs travel as the shared binary record, see avn_protocol.h
+typedef AvnRecord AVN;
+
+// Print every received record in text form (--dump)
+bool dumpRecords = false;
+
+// Time from generateAVN() in the controller until forwardAVNs() has passed the
+// notice on to the portal and StripePay
+LatencyBreakdown forwardLatency;
+
+// Counters and gauges written to METRICS_DIR/avn.prom, see metrics.h
+MetricsRegistry metrics;
+PipeMetrics fromATCPipe, fromATCRing, fromStripe, toPortal, toStripe;
+MetricCounter paymentsReceived;
+std::atomic<size_t> ringDepth{0};       // left in the ring after the last read
+
+// Shared-memory ring from the controller (--shm); the FIFO stays open as a fallback
+AvnRing atcRing;
+
+// Write end of a consumer FIFO, opened on first use and kept open across batches;
+// it is reopened only after the reader has gone away
+struct ConsumerPipe {
+    const char* path;
+    PipeMetrics &stats;
+    std::mutex mutex;
+    int fd = -1;
+
+    ConsumerPipe(const char* pipePath, PipeMetrics &pipeStats) : path(pipePath), stats(pipeStats) {}
+
+    // Called with mutex held; false (errno set) if no reader has the pipe open
+    bool ensureOpen() {
+        if (fd == -1) fd = open(path, O_WRONLY | O_NONBLOCK);
+        return fd != -1;
+    }
+
+    void closeFd() {
+        if (fd != -1) close(fd);
+        fd = -1;
+    }
 };
 
+ConsumerPipe portalPipe(AVN_TO_PORTAL_PIPE, toPortal);
+ConsumerPipe stripePipe(AVN_TO_STRIPE_PIPE, toStripe);
+
 void sendExitSignal() {
-    int fd_p = open(AVN_TO_PORTAL_PIPE, O_WRONLY | O_NONBLOCK);
-    if (fd_p != -1) {
-        const char* exitMsg = "EXIT";
-        write(fd_p, exitMsg, strlen(exitMsg));
-        close(fd_p);
-    }
-    
-      int fd_s = open(AVN_TO_STRIPE_PIPE, O_WRONLY | O_NONBLOCK);
-    if (fd_s != -1) {
-        const char* exitMsg = "EXIT";
-        write(fd_s, exitMsg, strlen(exitMsg));
-        close(fd_s);
+    for (ConsumerPipe *pipe : {&portalPipe, &stripePipe}) {
+        std::lock_guard<std::mutex> lock(pipe->mutex);
+        if (pipe->ensureOpen()) avnWriteExit(pipe->fd);
+        pipe->closeFd();
     }
 }
 
@@ -82,82 +112,104 @@ void createPipesIfNotExist() {
     cout << "All pipes created successfully" << endl;
 }
 
-// Parse AVN from buffer
-AVN parseAVN(const char* buffer) {
-    AVN newAVN;
-    memset(&newAVN, 0, sizeof(AVN));
-
-    char* token = strtok(const_cast<char*>(buffer), "|");
-    if (token) strncpy(newAVN.avnId, token, sizeof(newAVN.avnId) - 1);
-
-    token = strtok(NULL, "|");
-    if (token) strncpy(newAVN.flightName, token, sizeof(newAVN.flightName) - 1);
-
-    token = strtok(NULL, "|");
-    if (token) strncpy(newAVN.airline, token, sizeof(newAVN.airline) - 1);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.aircraftType = atoi(token);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.recordedSpeed = atoi(token);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.permissibleSpeed = atoi(token);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.issueTime = atol(token);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.fineAmount = atof(token);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.isPaid = atoi(token) == 1;
-
-    return newAVN;
+// Debug dump of one received record
+void dumpAVN(const char* source, const AVN& avn) {
+    if (!dumpRecords) return;
+    char text[256];
+    avnFormat(avn, text, sizeof(text));
+    cout << "[dump " << source << "] " << text;
 }
 
-// Serialize AVN to string
-void serializeAVN(const AVN& avn, char* buffer, size_t size) {
-    snprintf(buffer, size, "%s|%s|%s|%d|%d|%d|%ld|%.2f|%d\n",
-        avn.avnId,
-        avn.flightName,
-        avn.airline,
-        avn.aircraftType,
-        avn.recordedSpeed,
-        avn.permissibleSpeed,
-        avn.issueTime,
-        avn.fineAmount,
-        avn.isPaid ? 1 : 0
-    );
+// Write a batch of records to one pipe, at most PIPE_BUF bytes per write so a
+// reader never sees a record split by another writer. False if the pipe has no
+// reader; the records are then not sent.
+bool writeRecords(ConsumerPipe &pipe, const AVN* avns, int count) {
+    std::lock_guard<std::mutex> lock(pipe.mutex);
+    if (!pipe.ensureOpen()) {
+        pipe.stats.failures.add();
+        return false;
+    }
+    const int perWrite = PIPE_BUF / sizeof(AVN);
+    for (int i = 0; i < count; i += perWrite) {
+        int n = std::min(perWrite, count - i);
+        if (write(pipe.fd, avns + i, n * sizeof(AVN)) != (ssize_t)(n * sizeof(AVN))) {
+            pipe.stats.failures.add();
+            if (errno == EPIPE) pipe.closeFd();   // reader gone: reopen next batch
+            break;
+        }
+        pipe.stats.add(n, sizeof(AVN));
+    }
+    return true;
 }
 
-// Forward AVN to Portal and StripePay processes
-void forwardAVN(const AVN& avn) {
-    char buffer[512];
-    serializeAVN(avn, buffer, sizeof(buffer));
-
+// Forward AVNs to Portal and StripePay processes; one line per batch and consumer
+void forwardAVNs(const AVN* avns, int count) {
     // Forward to Portal
-    int fd_portal = open(AVN_TO_PORTAL_PIPE, O_WRONLY | O_NONBLOCK);
-    if (fd_portal != -1) {
-        write(fd_portal, buffer, strlen(buffer));
-        close(fd_portal);
-        cout << "AVN forwarded to Portal: " << avn.avnId << " | " << avn.flightName << endl;
+    if (writeRecords(portalPipe, avns, count)) {
+        if (count == 1)
+            cout << "AVN forwarded to Portal: " << avns[0].avnId << " | " << avns[0].flightName << "\n";
+        else
+            cout << count << " AVNs forwarded to Portal\n";
     } else {
         cerr << "Could not open portal pipe for writing: " << strerror(errno) << endl;
     }
 
     // Forward to StripePay
-    int fd_stripe = open(AVN_TO_STRIPE_PIPE, O_WRONLY | O_NONBLOCK);
-    if (fd_stripe != -1) {
-        write(fd_stripe, buffer, strlen(buffer));
-        close(fd_stripe);
-        cout << "AVN forwarded to StripePay: " << avn.avnId << " | " << avn.flightName << endl;
+    if (writeRecords(stripePipe, avns, count)) {
+        if (count == 1)
+            cout << "AVN forwarded to StripePay: " << avns[0].avnId << " | " << avns[0].flightName << "\n";
+        else
+            cout << count << " AVNs forwarded to StripePay\n";
     } else {
         cerr << "Could not open stripe pipe for writing: " << strerror(errno) << endl;
     }
 }
 
+void forwardAVN(const AVN& avn) {
+    forwardAVNs(&avn, 1);
+}
+
+// Store and forward one batch of records from the controller, whichever transport
+// it came over
+void handleATCRecords(const char* source, const AVN* records, int count) {
+    AVN accepted[64];
+    int kept = 0;
+    bool sawExit = false;
+    for (int i = 0; i < count && !exitRequested; i++) {
+        const AVN &newAVN = records[i];
+        if (!avnValid(newAVN)) {
+            cerr << source << " Skipping record with bad magic/version" << endl;
+            continue;
+        }
+        if (newAVN.messageType == AVN_MSG_EXIT) {
+            cout << source << " Received exit signal. Shutting down..." << endl;
+            exitRequested = true;  // [new added]
+            sawExit = true;
+            break;
+        }
+        dumpAVN("atc", newAVN);
+        accepted[kept++] = newAVN;
+    }
+
+    if (kept > 0) {
+        {
+            std::lock_guard<std::mutex> lock(avnMutex);
+            avnList.insert(avnList.end(), accepted, accepted + kept);
+        }
+        // One line per batch, outside the lock; --dump shows every record
+        if (kept == 1)
+            cout << source << " New AVN received: " << accepted[0].avnId << " | " << accepted[0].flightName << "\n";
+        else
+            cout << source << " " << kept << " new AVNs received\n";
+        forwardAVNs(accepted, kept);
+        int64_t now = avnClockNs();
+        for (int i = 0; i < kept; i++)
+            forwardLatency.record(accepted[i].aircraftType, accepted[i].flags & AVN_FLAG_EMERGENCY,
+                                  now - accepted[i].generatedNs);
+    }
+    if (sawExit) sendExitSignal();
+}
+
 // Read from ATC and process AVNs
 void readFromATCtoAVNPipe() {
     int fd = open(ATC_TO_AVN_PIPE, O_RDONLY);
@@ -166,28 +218,15 @@ void readFromATCtoAVNPipe() {
         return;
     }
 
-    char buffer[1024];
+    // The controller batches many records into one write; they are read straight
+    // into this array
+    AVN records[32];
+    AvnStreamReader reader;
     while (!exitRequested) {  // [new added]
-        ssize_t bytesRead = read(fd, buffer, sizeof(buffer) - 1);
-        if (bytesRead > 0) {
-            buffer[bytesRead] = '\0';
-            if (strncmp(buffer, "EXIT", 4) == 0) {
-                cout << "[AVN Pipe] Received exit signal. Shutting down..." << endl;
-                exitRequested = true;  // [new added]
-                   sendExitSignal();
-                
-                break;
-            }
-
-            AVN newAVN = parseAVN(buffer);
-
-            {
-                std::lock_guard<std::mutex> lock(avnMutex);
-                avnList.push_back(newAVN);
-                cout << "[AVN Pipe] New AVN received: " << newAVN.avnId << " | " << newAVN.flightName << endl;
-            }
-
-            forwardAVN(newAVN);
+        int count = reader.readFrom(fd, records, 32);
+        if (count >= 0) {
+            fromATCPipe.add(count, sizeof(AVN));
+            handleATCRecords("[AVN Pipe]", records, count);
         } else {
             std::this_thread::sleep_for(std::chrono::milliseconds(100));  // [new added]
         }
@@ -196,6 +235,23 @@ void readFromATCtoAVNPipe() {
     close(fd);
 }
 
+// Read from the shared-memory ring; the futex wait wakes as soon as the
+// controller publishes, the timeout only bounds the exit check
+void readFromATCRing() {
+    AVN records[64];
+    while (!exitRequested) {
+        int count = atcRing.read(records, 64, 100);
+        fromATCRing.add(count, sizeof(AVN));
+        ringDepth.store(atcRing.depth(), std::memory_order_relaxed);
+        handleATCRecords("[AVN Ring]", records, count);
+    }
+
+    // The FIFO reader may still be blocked in open(); opening the write end
+    // releases it and it sees exitRequested
+    int fd = open(ATC_TO_AVN_PIPE, O_WRONLY | O_NONBLOCK);
+    if (fd != -1) close(fd);
+}
+
 // Listen for payment updates from StripePay
 void listenForPaymentUpdates() {
     int fd = open(STRIPE_TO_AVN_PIPE, O_RDONLY);
@@ -204,19 +260,26 @@ void listenForPaymentUpdates() {
         return;
     }
 
-    char buffer[1024];
+    AVN records[8];
+    AvnStreamReader reader;
     while (!exitRequested) {  // [new added]
-        ssize_t bytesRead = read(fd, buffer, sizeof(buffer) - 1);
-        if (bytesRead > 0) {
-            buffer[bytesRead] = '\0';
-
-            AVN updatedAVN = parseAVN(buffer);
+        int count = reader.readFrom(fd, records, 8);
+        if (count < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));  // [new added]
+            continue;
+        }
+        fromStripe.add(count, sizeof(AVN));
+        for (int i = 0; i < count; i++) {
+            const AVN &updatedAVN = records[i];
+            if (!avnValid(updatedAVN) || updatedAVN.messageType != AVN_MSG_NOTICE) continue;
+            dumpAVN("stripe", updatedAVN);
 
             {
                 std::lock_guard<std::mutex> lock(avnMutex);
                 for (auto& avn : avnList) {
                     if (strcmp(avn.avnId, updatedAVN.avnId) == 0) {
                         avn.isPaid = updatedAVN.isPaid;
+                        if (avn.isPaid) paymentsReceived.add();
                         cout << "[AVN Pipe] Payment status updated for AVN " << avn.avnId 
                              << " | " << avn.flightName << " | Paid: " << (avn.isPaid ? "Yes" : "No") << endl;
 
@@ -225,8 +288,6 @@ void listenForPaymentUpdates() {
                     }
                 }
             }
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));  // [new added]
         }
     }
 
@@ -272,17 +333,66 @@ void displayAVNs() {
     }
 }
 
-int main() {
+void registerMetrics(bool useRing) {
+    fromATCPipe.registerAs(metrics, "avn", "atc_to_avn", false);
+    if (useRing) fromATCRing.registerAs(metrics, "avn", "atc_avn_ring", false);
+    fromStripe.registerAs(metrics, "avn", "stripe_to_avn", false);
+    toPortal.registerAs(metrics, "avn", "avn_to_portal", true);
+    toStripe.registerAs(metrics, "avn", "avn_to_stripe", true);
+    metrics.counter("avn_payments_total", "Payment confirmations received from StripePay", "", paymentsReceived);
+    metrics.gauge("avn_notices", "Violation notices held", "", []() {
+        std::lock_guard<std::mutex> lock(avnMutex);
+        return (double)avnList.size();
+    });
+    metrics.gauge("avn_notices_paid", "Violation notices marked paid", "", []() {
+        std::lock_guard<std::mutex> lock(avnMutex);
+        return (double)std::count_if(avnList.begin(), avnList.end(), [](const AVN &a) { return a.isPaid != 0; });
+    });
+    if (useRing)
+        metrics.gauge("avn_ring_depth", "Records in the shared-memory ring not yet read", "",
+                      []() { return (double)ringDepth.load(std::memory_order_relaxed); });
+}
+
+int main(int argc, char* argv[]) {
+    bool useRing = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dump") == 0) {
+            dumpRecords = true;
+        } else if (strcmp(argv[i], "--shm") == 0) {
+            useRing = true;
+        } else {
+            cerr << "Usage: " << argv[0] << " [--dump] [--shm]" << endl;
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);   // a consumer going away must not kill the generator
     createPipesIfNotExist();
+    if (useRing && !atcRing.create(AVN_RING_NAME)) {
+        cerr << "Error creating shared-memory ring " << AVN_RING_NAME << ": " << strerror(errno)
+             << "; using the pipe only" << endl;
+        useRing = false;
+    }
     cout << "AVN Generator Process Started" << endl;
+    LatencyReporter latency("avn");
+    latency.add("avn_forwarded", "", &forwardLatency);
+    latency.start();
+    registerMetrics(useRing);
+    metrics.startExport("avn");
 
     std::thread atcReaderThread(readFromATCtoAVNPipe);
+    std::thread ringReaderThread;
+    if (useRing) ringReaderThread = std::thread(readFromATCRing);
     std::thread paymentListenerThread(listenForPaymentUpdates);
     std::thread displayThread(displayAVNs);
 
     atcReaderThread.join();
+    if (ringReaderThread.joinable()) ringReaderThread.join();
+    atcRing.detach();
     paymentListenerThread.join();
     displayThread.join();
+    latency.stop();
+    metrics.stopExport();
 
     cout << "AVN Generator Process Terminated Gracefully." << endl;  // [new added]
         sendExitSignal();
@@ -0,0 +1,126 @@
+// AVN wire protocol shared by the ATC controller (module3.cpp), the AVN generator
+// (avn2.cpp), StripePay (stest.cpp) and the airline portal (portal2.cpp).
+//
+// Every message on the AVN pipes is one fixed-size 128-byte AvnRecord in
+// little-endian byte order. Hops move records as raw bytes; nothing is formatted
+// or parsed on the way. avnFormat() gives the old text form for debug dumps only.
+#ifndef AVN_PROTOCOL_H
+#define AVN_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <type_traits>
+#include <unistd.h>
+
+const uint32_t AVN_MAGIC = 0x314E5641;      // "AVN1" in little-endian byte order
+const uint16_t AVN_PROTOCOL_VERSION = 3;
+
+// Message types
+const uint16_t AVN_MSG_NOTICE = 1;          // a new or updated violation notice
+const uint16_t AVN_MSG_EXIT = 2;            // the sender is shutting down
+
+// Flags
+const uint8_t AVN_FLAG_EMERGENCY = 1;       // issued to an emergency flight
+
+struct AvnRecord {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t messageType;
+    char avnId[20];
+    char flightName[22];
+    char airline[30];
+    uint8_t isPaid;
+    uint8_t flags;                          // AVN_FLAG_*
+    uint16_t airportId;                     // issuing airport of a multi-airport controller
+    int32_t aircraftType;
+    int32_t recordedSpeed;
+    int32_t permissibleSpeed;
+    int64_t issueTime;                      // seconds since the epoch
+    int64_t dueDate;                        // seconds since the epoch
+    double fineAmount;                      // PKR, IEEE 754
+    int64_t generatedNs;                    // avnClockNs() when the controller issued it
+};
+
+// The layout is the protocol: any change here needs a new AVN_PROTOCOL_VERSION
+static_assert(sizeof(AvnRecord) == 128, "AvnRecord must stay 128 bytes");
+static_assert(std::is_trivially_copyable<AvnRecord>::value, "AvnRecord is copied as raw bytes");
+static_assert(std::is_standard_layout<AvnRecord>::value, "AvnRecord needs a fixed layout");
+static_assert(offsetof(AvnRecord, avnId) == 8, "AvnRecord layout");
+static_assert(offsetof(AvnRecord, airline) == 50, "AvnRecord layout");
+static_assert(offsetof(AvnRecord, isPaid) == 80, "AvnRecord layout");
+static_assert(offsetof(AvnRecord, airportId) == 82, "AvnRecord layout");
+static_assert(offsetof(AvnRecord, aircraftType) == 84, "AvnRecord layout");
+static_assert(offsetof(AvnRecord, issueTime) == 96, "AvnRecord layout");
+static_assert(offsetof(AvnRecord, fineAmount) == 112, "AvnRecord layout");
+static_assert(offsetof(AvnRecord, generatedNs) == 120, "AvnRecord layout");
+static_assert(std::numeric_limits<double>::is_iec559, "fineAmount is sent as IEEE 754");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "records are sent in host order, which must be little-endian");
+
+// CLOCK_MONOTONIC in nanoseconds. It is one clock for every process on the host, so
+// a receiver can subtract generatedNs to get the end-to-end latency of a notice.
+inline int64_t avnClockNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Zeroed record with the header filled in
+inline void avnInit(AvnRecord &record, uint16_t messageType) {
+    memset(&record, 0, sizeof(record));
+    record.magic = AVN_MAGIC;
+    record.version = AVN_PROTOCOL_VERSION;
+    record.messageType = messageType;
+}
+
+inline bool avnValid(const AvnRecord &record) {
+    return record.magic == AVN_MAGIC && record.version == AVN_PROTOCOL_VERSION;
+}
+
+// Write one record; false if the pipe took less than a whole record
+inline bool avnWrite(int fd, const AvnRecord &record) {
+    return write(fd, &record, sizeof(record)) == (ssize_t)sizeof(record);
+}
+
+inline bool avnWriteExit(int fd) {
+    AvnRecord record;
+    avnInit(record, AVN_MSG_EXIT);
+    return avnWrite(fd, record);
+}
+
+// Debug dump in the pre-binary text form
+inline int avnFormat(const AvnRecord &record, char *buffer, size_t size) {
+    return snprintf(buffer, size, "%.20s|%.22s|%.30s|%d|%d|%d|%lld|%.2f|%d\n",
+                    record.avnId, record.flightName, record.airline, record.aircraftType,
+                    record.recordedSpeed, record.permissibleSpeed, (long long)record.issueTime,
+                    record.fineAmount, record.isPaid ? 1 : 0);
+}
+
+// Reads whole records from a pipe. read() goes straight into the caller's record
+// array; only the tail of a record split across two reads is carried over.
+class AvnStreamReader {
+public:
+    // One read() into out. Returns the number of complete records now in out (0 if
+    // the read ended inside a record), or -1 at end of file or on error.
+    int readFrom(int fd, AvnRecord *out, int maxRecords) {
+        char *bytes = reinterpret_cast<char *>(out);
+        memcpy(bytes, carry, carried);
+        ssize_t n = read(fd, bytes + carried, maxRecords * sizeof(AvnRecord) - carried);
+        if (n <= 0) return -1;
+
+        size_t total = carried + n;
+        int complete = (int)(total / sizeof(AvnRecord));
+        carried = total % sizeof(AvnRecord);
+        memcpy(carry, bytes + complete * sizeof(AvnRecord), carried);
+        return complete;
+    }
+
+private:
+    char carry[sizeof(AvnRecord)];
+    size_t carried = 0;
+};
+
+#endif
@@ -0,0 +1,181 @@
+// Shared-memory transport for the ATC -> AVN generator hop.
+//
+// The AVN generator (avn2 --shm) creates a POSIX shared-memory ring of AvnRecords;
+// the controller's AVN emitter attaches to it when it exists and falls back to the
+// ATC_TO_AVN FIFO when it does not. There is one writer (the emitter thread) and one
+// reader, so head and tail are plain SPSC counters; the reader sleeps on a futex
+// that the writer only wakes when the reader has said it is about to sleep.
+#ifndef AVN_RING_H
+#define AVN_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "avn_protocol.h"
+
+#define AVN_RING_NAME "/atc_avn_ring"
+
+const uint32_t AVN_RING_MAGIC = 0x474E5241;     // "ARNG"
+const uint32_t AVN_RING_VERSION = 1;
+const uint32_t AVN_RING_CAPACITY = 65536;       // records, power of two (8 MiB)
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "ring counters are shared between processes and must be lock-free");
+
+struct AvnRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    std::atomic<int32_t> readerPid;             // 0 once the reader has detached
+
+    alignas(64) std::atomic<uint64_t> head;     // next slot the writer fills
+    alignas(64) std::atomic<uint64_t> tail;     // next slot the reader takes
+    alignas(64) std::atomic<uint32_t> dataSignal;      // futex word, bumped on every publish
+    std::atomic<uint32_t> readerSleeping;
+};
+
+class AvnRing {
+public:
+    ~AvnRing() { detach(); }
+
+    // Reader side: replace any stale segment with an empty ring owned by this process
+    bool create(const char *name, uint32_t capacity = AVN_RING_CAPACITY) {
+        shm_unlink(name);
+        int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0666);
+        if (fd == -1) return false;
+        size_t size = sizeof(AvnRingHeader) + (size_t)capacity * sizeof(AvnRecord);
+        if (ftruncate(fd, size) == -1 || !map(fd, size)) {
+            close(fd);
+            shm_unlink(name);
+            return false;
+        }
+        close(fd);
+
+        header->capacity = capacity;
+        header->version = AVN_RING_VERSION;
+        header->head.store(0, std::memory_order_relaxed);
+        header->tail.store(0, std::memory_order_relaxed);
+        header->readerPid.store(getpid(), std::memory_order_relaxed);
+        header->magic = AVN_RING_MAGIC;
+        std::atomic_thread_fence(std::memory_order_release);
+        owner = name;
+        return true;
+    }
+
+    // Writer side: map an existing ring whose reader is still alive
+    bool attach(const char *name) {
+        int fd = shm_open(name, O_RDWR, 0);
+        if (fd == -1) return false;
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(AvnRingHeader) &&
+                  map(fd, st.st_size);
+        close(fd);
+        if (!ok) return false;
+        uint32_t capacity = header->capacity;
+        if (header->magic != AVN_RING_MAGIC || header->version != AVN_RING_VERSION ||
+            capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+            st.st_size != (off_t)(sizeof(AvnRingHeader) + (size_t)capacity * sizeof(AvnRecord)) ||
+            !readerAlive()) {
+            detach();
+            return false;
+        }
+        return true;
+    }
+
+    void detach() {
+        if (!header) return;
+        if (owner) {
+            header->readerPid.store(0, std::memory_order_release);
+            shm_unlink(owner);
+            owner = nullptr;
+        }
+        munmap(header, mappedSize);
+        header = nullptr;
+        slots = nullptr;
+    }
+
+    bool attached() const { return header != nullptr; }
+
+    // Records published but not yet taken
+    size_t depth() const {
+        if (!header) return 0;
+        return (size_t)(header->head.load(std::memory_order_acquire) - header->tail.load(std::memory_order_acquire));
+    }
+
+    bool readerAlive() const {
+        int pid = header->readerPid.load(std::memory_order_acquire);
+        return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+    }
+
+    // Copy as many records as fit; returns the number written and wakes the reader
+    size_t write(const AvnRecord *records, size_t count) {
+        uint64_t head = header->head.load(std::memory_order_relaxed);
+        uint64_t tail = header->tail.load(std::memory_order_acquire);
+        size_t space = header->capacity - (size_t)(head - tail);
+        if (count > space) count = space;
+        for (size_t i = 0; i < count; i++)
+            slots[(head + i) & (header->capacity - 1)] = records[i];
+        if (count == 0) return 0;
+
+        header->head.store(head + count, std::memory_order_release);
+        header->dataSignal.fetch_add(1, std::memory_order_seq_cst);
+        if (header->readerSleeping.load(std::memory_order_seq_cst))
+            futex(&header->dataSignal, FUTEX_WAKE, 1, nullptr);
+        return count;
+    }
+
+    // Take up to maxRecords, sleeping up to timeoutMs while the ring is empty
+    int read(AvnRecord *out, int maxRecords, int timeoutMs) {
+        uint64_t tail = header->tail.load(std::memory_order_relaxed);
+        uint64_t head = header->head.load(std::memory_order_acquire);
+        if (head == tail) {
+            uint32_t signal = header->dataSignal.load(std::memory_order_seq_cst);
+            header->readerSleeping.store(1, std::memory_order_seq_cst);
+            head = header->head.load(std::memory_order_seq_cst);
+            if (head == tail) {
+                struct timespec timeout = {timeoutMs / 1000, (long)(timeoutMs % 1000) * 1000000};
+                futex(&header->dataSignal, FUTEX_WAIT, signal, &timeout);
+                head = header->head.load(std::memory_order_acquire);
+            }
+            header->readerSleeping.store(0, std::memory_order_relaxed);
+        }
+
+        int count = (int)std::min<uint64_t>(head - tail, (uint64_t)maxRecords);
+        for (int i = 0; i < count; i++)
+            out[i] = slots[(tail + i) & (header->capacity - 1)];
+        header->tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    AvnRingHeader *header = nullptr;
+    AvnRecord *slots = nullptr;
+    size_t mappedSize = 0;
+    const char *owner = nullptr;        // set on the reader side, which unlinks on detach
+
+    bool map(int fd, size_t size) {
+        void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) return false;
+        header = static_cast<AvnRingHeader *>(base);
+        slots = reinterpret_cast<AvnRecord *>(header + 1);
+        mappedSize = size;
+        return true;
+    }
+
+    // Shared (not FUTEX_PRIVATE) futex: the two sides are different processes
+    static long futex(std::atomic<uint32_t> *word, int op, uint32_t value, const struct timespec *timeout) {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), op, value, timeout, nullptr, 0);
+    }
+};
+
+#endif
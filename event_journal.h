@@ -0,0 +1,221 @@
+// Event journal of a simulation run (module3 --journal), read back by --replay.
+//
+// A journal is one header, the airport's runways and flights in id order, then an
+// append-only stream of fixed-size 16-byte events in time order. Each event is
+// one state change: admission, runway assignment, speed tick or phase change,
+// violation, AVN, ground fault or runway release. The writer only appends, so the
+// events of a run that was killed are still readable up to the last whole record.
+#ifndef EVENT_JOURNAL_H
+#define EVENT_JOURNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+const uint32_t JOURNAL_MAGIC = 0x4A435441;     // "ATCJ"
+const uint16_t JOURNAL_VERSION = 2;          // 2: 32-bit a, for waits past 32767 s
+
+enum JournalEventType : uint8_t {
+    JEV_ADMIT = 1,          // arg: initial phase, a: initial speed
+    JEV_ASSIGN = 2,         // arg: runway, a: seconds waited for it
+    JEV_SPEED = 3,          // arg: phase, a: speed
+    JEV_PHASE = 4,          // arg: new phase, a: speed on entering it
+    JEV_COMPLETE = 5,
+    JEV_VIOLATION = 6,      // arg: phase, a: speed that opened the episode
+    JEV_AVN = 7,            // a: recorded speed, b: permissible speed
+    JEV_GROUND_FAULT = 8,
+    JEV_RELEASE = 9         // arg: runway
+};
+
+struct JournalHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t airportId;
+    char code[8];
+    uint32_t runwayCount;
+    uint32_t flightCount;
+    int64_t originWall;                 // calendar time of simulation time 0, seconds
+    uint64_t seed;
+    uint8_t virtualClock;
+    uint8_t reserved[7];
+};
+
+struct JournalRunway {
+    char name[16];
+    int32_t ops;
+};
+
+struct JournalFlight {
+    char flightName[30];
+    char airline[30];
+    int8_t type;
+    int8_t direction;
+    uint8_t isEmergency;
+    uint8_t reserved;
+    int32_t scheduledTime;
+    int32_t priority;
+};
+
+struct JournalEvent {
+    uint32_t timeMs;                    // simulation time
+    int32_t flight;
+    uint8_t type;
+    int8_t arg;
+    int16_t b;
+    int32_t a;
+};
+
+static_assert(sizeof(JournalHeader) == 48, "JournalHeader layout");
+static_assert(sizeof(JournalRunway) == 20, "JournalRunway layout");
+static_assert(sizeof(JournalFlight) == 72, "JournalFlight layout");
+static_assert(sizeof(JournalEvent) == 16, "JournalEvent layout");
+static_assert(std::is_trivially_copyable<JournalEvent>::value, "events are written as raw bytes");
+
+// Appends events from any thread. An append is a 16-byte copy under a mutex held
+// for nothing else; a background thread writes the batch out every FLUSH_MS, so
+// flight threads never make a syscall. The time is read under the same mutex, which
+// keeps the file in time order.
+class JournalWriter {
+public:
+    static const int FLUSH_MS = 20;
+
+    ~JournalWriter() { close(); }
+
+    bool open(const char *path, const JournalHeader &header, const std::vector<JournalRunway> &runways,
+              const std::vector<JournalFlight> &flights, std::function<long long()> clockMs) {
+        out = fopen(path, "wb");
+        if (!out) return false;
+        bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                  fwrite(runways.data(), sizeof(JournalRunway), runways.size(), out) == runways.size() &&
+                  fwrite(flights.data(), sizeof(JournalFlight), flights.size(), out) == flights.size();
+        if (!ok) {
+            fclose(out);
+            out = nullptr;
+            return false;
+        }
+        now = clockMs;
+        stopping = false;
+        flusher = std::thread(&JournalWriter::flushLoop, this);
+        return true;
+    }
+
+    void append(int type, int flight, int arg = 0, int a = 0, int b = 0) {
+        JournalEvent ev;
+        ev.flight = flight;
+        ev.type = (uint8_t)type;
+        ev.arg = (int8_t)arg;
+        ev.a = a;
+        ev.b = (int16_t)b;
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        ev.timeMs = (uint32_t)now();
+        pending.push_back(ev);
+    }
+
+    // Write what is left and close the file; false if any write failed
+    bool close() {
+        if (!out) return true;
+        stopping = true;
+        if (flusher.joinable()) flusher.join();
+        flush();
+        bool ok = !failed && fclose(out) == 0;
+        out = nullptr;
+        return ok;
+    }
+
+    long long eventsWritten() const { return written; }
+
+private:
+    FILE *out = nullptr;
+    std::function<long long()> now;
+    std::mutex pendingMutex;
+    std::vector<JournalEvent> pending;
+    std::vector<JournalEvent> batch;    // flush thread only
+    std::atomic<bool> stopping{false};
+    std::thread flusher;
+    bool failed = false;
+    long long written = 0;
+
+    void flush() {
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            batch.swap(pending);
+        }
+        if (batch.empty()) return;
+        if (fwrite(batch.data(), sizeof(JournalEvent), batch.size(), out) != batch.size()) failed = true;
+        fflush(out);
+        written += batch.size();
+        batch.clear();
+    }
+
+    void flushLoop() {
+        while (!stopping) {
+            flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(FLUSH_MS));
+        }
+    }
+};
+
+// Read-only view of a journal file, memory-mapped
+class JournalReader {
+public:
+    ~JournalReader() { close(); }
+
+    // False if the file is missing, too short or not a journal of this version
+    bool open(const char *path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd == -1) return false;
+        struct stat st;
+        if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(JournalHeader)) {
+            ::close(fd);
+            return false;
+        }
+        size = st.st_size;
+        void *base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) return false;
+        data = static_cast<const char *>(base);
+
+        const JournalHeader &h = header();
+        size_t tables = sizeof(JournalHeader) + (size_t)h.runwayCount * sizeof(JournalRunway) +
+                        (size_t)h.flightCount * sizeof(JournalFlight);
+        if (h.magic != JOURNAL_MAGIC || h.version != JOURNAL_VERSION || tables > size) {
+            close();
+            return false;
+        }
+        eventData = data + tables;
+        count = (size - tables) / sizeof(JournalEvent);   // a torn last record is ignored
+        madvise(base, size, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    void close() {
+        if (data) munmap(const_cast<char *>(data), size);
+        data = nullptr;
+        count = 0;
+    }
+
+    const JournalHeader &header() const { return *reinterpret_cast<const JournalHeader *>(data); }
+    const JournalRunway *runways() const { return reinterpret_cast<const JournalRunway *>(data + sizeof(JournalHeader)); }
+    const JournalFlight *flights() const { return reinterpret_cast<const JournalFlight *>(runways() + header().runwayCount); }
+    const JournalEvent *events() const { return reinterpret_cast<const JournalEvent *>(eventData); }
+    size_t eventCount() const { return count; }
+
+private:
+    const char *data = nullptr;
+    const char *eventData = nullptr;
+    size_t size = 0;
+    size_t count = 0;
+};
+
+#endif
@@ -0,0 +1,195 @@
+// Latency histograms shared by the ATC controller, the AVN generator, StripePay and
+// the airline portal.
+//
+// A LatencyHistogram is HDR-style: values below 64 ns get a bucket each, above that
+// every power of two is split into 64 linear sub-buckets, so any percentile is
+// within 1/64 (1.6%) of the true value. Recording is one relaxed atomic add, safe
+// from any thread. LatencyBreakdown keeps one histogram per aircraft type and
+// emergency flag, and LatencyReporter appends their p50/p99/p99.9 as JSON lines to
+// LATENCY_LOG every LATENCY_REPORT_MS and once more at exit.
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LATENCY_LOG "/tmp/atc_latency.jsonl"
+
+const int LATENCY_REPORT_MS = 10000;
+
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 6;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int MAX_BITS = 44;      // values clamp at 2^44 ns, about 4.9 hours
+    static const int BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+    void record(int64_t ns) {
+        uint64_t value = ns < 0 ? 0 : (uint64_t)ns;
+        buckets[indexOf(value)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t seen = maxValue.load(std::memory_order_relaxed);
+        while (value > seen && !maxValue.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+    }
+
+    // Add the counts of this histogram to a plain array of BUCKETS counters
+    void addTo(std::vector<uint64_t> &counts, uint64_t &max) const {
+        for (int i = 0; i < BUCKETS; i++) counts[i] += buckets[i].load(std::memory_order_relaxed);
+        max = std::max(max, maxValue.load(std::memory_order_relaxed));
+    }
+
+    static int indexOf(uint64_t value) {
+        if (value < (uint64_t)SUB_COUNT) return (int)value;
+        int msb = 63 - __builtin_clzll(value);
+        if (msb >= MAX_BITS) return BUCKETS - 1;
+        uint64_t top = value >> (msb - SUB_BITS);   // SUB_COUNT .. 2*SUB_COUNT-1
+        return (msb - SUB_BITS + 1) * SUB_COUNT + (int)(top - SUB_COUNT);
+    }
+
+    // Midpoint of the values that fall into bucket index
+    static uint64_t valueOf(int index) {
+        if (index < SUB_COUNT) return index;
+        int shift = index / SUB_COUNT - 1;
+        uint64_t low = (uint64_t)(SUB_COUNT + index % SUB_COUNT) << shift;
+        return low + ((1ULL << shift) >> 1);
+    }
+
+    // Value at quantile q (0..1) of counts, 0 if empty
+    static uint64_t percentile(const std::vector<uint64_t> &counts, uint64_t total, double q) {
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)(q * total + 0.999999);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) return valueOf(i);
+        }
+        return valueOf(BUCKETS - 1);
+    }
+
+private:
+    std::atomic<uint64_t> buckets[BUCKETS] = {};
+    std::atomic<uint64_t> maxValue{0};
+};
+
+// One histogram per aircraft type (0-3) and emergency flag
+class LatencyBreakdown {
+public:
+    void record(int type, bool emergency, int64_t ns) {
+        cells[type & 3][emergency ? 1 : 0].record(ns);
+    }
+
+    // JSON array with the percentiles of every non-empty split and of all of them
+    std::string json() const {
+        static const char* typeNames[] = {"Commercial", "Cargo", "Military", "Medical"};
+        std::string out = "[";
+        std::vector<uint64_t> all(LatencyHistogram::BUCKETS, 0);
+        uint64_t allMax = 0;
+        for (int type = 0; type < 4; type++) {
+            for (int emergency = 0; emergency < 2; emergency++) {
+                std::vector<uint64_t> counts(LatencyHistogram::BUCKETS, 0);
+                uint64_t max = 0;
+                cells[type][emergency].addTo(counts, max);
+                cells[type][emergency].addTo(all, allMax);
+                appendSplit(out, typeNames[type], emergency ? "true" : "false", counts, max);
+            }
+        }
+        appendSplit(out, "all", "null", all, allMax);
+        out += "]";
+        return out;
+    }
+
+private:
+    LatencyHistogram cells[4][2];
+
+    static void appendSplit(std::string &out, const char* type, const char* emergency,
+                            const std::vector<uint64_t> &counts, uint64_t max) {
+        uint64_t total = 0;
+        for (uint64_t c : counts) total += c;
+        if (total == 0) return;
+        // A bucket midpoint can lie above the largest value recorded into it
+        uint64_t p50 = std::min(LatencyHistogram::percentile(counts, total, 0.50), max);
+        uint64_t p99 = std::min(LatencyHistogram::percentile(counts, total, 0.99), max);
+        uint64_t p999 = std::min(LatencyHistogram::percentile(counts, total, 0.999), max);
+        char split[256];
+        snprintf(split, sizeof(split),
+                 "%s{\"type\":\"%s\",\"emergency\":%s,\"count\":%llu,\"p50\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}",
+                 out.size() > 1 ? "," : "", type, emergency, (unsigned long long)total,
+                 p50 / 1000.0, p99 / 1000.0, p999 / 1000.0, max / 1000.0);
+        out += split;
+    }
+};
+
+// Appends one JSON line per registered breakdown (values in microseconds) to
+// LATENCY_LOG: periodically from a background thread, and a final one on stop()
+class LatencyReporter {
+public:
+    explicit LatencyReporter(const char* processName) : process(processName) {}
+    ~LatencyReporter() { stop(); }
+
+    // Register before start(); tag tells apart several breakdowns of one metric
+    void add(const char* metric, const std::string &tag, const LatencyBreakdown *breakdown) {
+        entries.push_back({metric, tag, breakdown});
+    }
+
+    void start() {
+        reporter = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            while (!wake.wait_for(lock, std::chrono::milliseconds(LATENCY_REPORT_MS), [this]() { return stopping; })) {
+                lock.unlock();
+                report(false);
+                lock.lock();
+            }
+        });
+    }
+
+    void stop() {
+        if (!reporter.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        reporter.join();
+        report(true);
+    }
+
+private:
+    struct Entry {
+        const char* metric;
+        std::string tag;
+        const LatencyBreakdown *breakdown;
+    };
+
+    std::string process;
+    std::vector<Entry> entries;
+    std::thread reporter;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void report(bool final) {
+        FILE* out = fopen(LATENCY_LOG, "a");
+        if (!out) return;
+        std::string lines;
+        for (const Entry &e : entries) {
+            lines += "{\"process\":\"" + process + "\",\"metric\":\"" + e.metric + "\"";
+            if (!e.tag.empty()) lines += ",\"airport\":\"" + e.tag + "\"";
+            lines += ",\"unit\":\"us\",\"final\":" + std::string(final ? "true" : "false") +
+                     ",\"time\":" + std::to_string((long long)time(NULL)) +
+                     ",\"splits\":" + e.breakdown->json() + "}\n";
+        }
+        fputs(lines.c_str(), out);
+        fclose(out);
+    }
+};
+
+#endif
@@ -0,0 +1,186 @@
+// Metrics registry shared by the ATC controller, the AVN generator, StripePay and
+// the airline portal.
+//
+// Counters are sharded per thread: each thread adds to its own cache line with a
+// relaxed atomic add, so counting on a hot path costs about as much as a plain
+// increment and never contends. Gauges are sampled from a callback when the
+// metrics are written. Every METRICS_REFRESH_MS the registry renders all of them
+// in the Prometheus text format to METRICS_DIR/<process>.prom, replacing the file
+// atomically, so node_exporter's textfile collector (or a plain cat) always reads
+// a whole snapshot.
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#define METRICS_DIR "/tmp/atc_metrics"
+
+const int METRICS_REFRESH_MS = 1000;
+
+// Cache-line slot of the calling thread; threads beyond SHARDS share slots
+inline int metricsSlot() {
+    static std::atomic<int> nextSlot{0};
+    thread_local int slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+class MetricCounter {
+public:
+    static const int SHARDS = 16;
+
+    void add(uint64_t n = 1) {
+        shards[metricsSlot() & (SHARDS - 1)].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const Shard &s : shards) total += s.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    Shard shards[SHARDS];
+};
+
+class MetricsRegistry {
+public:
+    ~MetricsRegistry() { stopExport(); }
+
+    // Register before startExport(). labels is the inside of the braces, e.g.
+    // "airport=\"LHE\"", or empty; samples of one name may differ only in labels.
+    void counter(const char* name, const char* help, const std::string &labels, const MetricCounter &c) {
+        counter(name, help, labels, [&c]() { return (double)c.value(); });
+    }
+
+    // A counter kept elsewhere, read through sample()
+    void counter(const char* name, const char* help, const std::string &labels, std::function<double()> sample) {
+        add(name, help, "counter", labels, std::move(sample));
+    }
+
+    // sample() runs on the export thread and must be thread-safe
+    void gauge(const char* name, const char* help, const std::string &labels, std::function<double()> sample) {
+        add(name, help, "gauge", labels, std::move(sample));
+    }
+
+    // Prometheus text exposition format, samples of one name grouped under one HELP
+    std::string render() const {
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        std::string out;
+        std::vector<bool> done(metrics.size(), false);
+        for (size_t i = 0; i < metrics.size(); i++) {
+            if (done[i]) continue;
+            const Metric &first = metrics[i];
+            out += "# HELP " + first.name + " " + first.help + "\n";
+            out += "# TYPE " + first.name + " " + first.type + "\n";
+            for (size_t j = i; j < metrics.size(); j++) {
+                if (done[j] || metrics[j].name != first.name) continue;
+                done[j] = true;
+                char value[32];
+                snprintf(value, sizeof(value), " %.17g\n", metrics[j].sample());
+                out += metrics[j].name;
+                if (!metrics[j].labels.empty()) out += "{" + metrics[j].labels + "}";
+                out += value;
+            }
+        }
+        return out;
+    }
+
+    // Write METRICS_DIR/<process>.prom now and every METRICS_REFRESH_MS
+    void startExport(const char* process) {
+        mkdir(METRICS_DIR, 0777);
+        path = std::string(METRICS_DIR) + "/" + process + ".prom";
+        stopping = false;
+        exporter = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            do {
+                lock.unlock();
+                writeFile();
+                lock.lock();
+            } while (!wake.wait_for(lock, std::chrono::milliseconds(METRICS_REFRESH_MS), [this]() { return stopping; }));
+        });
+    }
+
+    // Stop refreshing; the file keeps the final values
+    void stopExport() {
+        if (!exporter.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        exporter.join();
+        writeFile();
+    }
+
+private:
+    struct Metric {
+        std::string name;
+        std::string help;
+        const char* type;
+        std::string labels;
+        std::function<double()> sample;
+    };
+
+    mutable std::mutex metricsMutex;      // registration and rendering only
+    std::deque<Metric> metrics;
+    std::string path;
+    std::thread exporter;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void add(const char* name, const char* help, const char* type, const std::string &labels,
+             std::function<double()> sample) {
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        metrics.push_back({name, help, type, labels, std::move(sample)});
+    }
+
+    // Write beside the target and rename over it, so readers never see half a file
+    void writeFile() {
+        std::string text = render();
+        std::string tmp = path + ".tmp";
+        FILE* out = fopen(tmp.c_str(), "w");
+        if (!out) return;
+        bool ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+        if (fclose(out) != 0 || !ok || rename(tmp.c_str(), path.c_str()) != 0)
+            remove(tmp.c_str());
+    }
+};
+
+// Records and bytes through one pipe or ring, and failed writes on the sending side
+struct PipeMetrics {
+    MetricCounter records;
+    MetricCounter bytes;
+    MetricCounter failures;
+
+    void add(int count, size_t recordSize) {
+        records.add(count);
+        bytes.add(count * recordSize);
+    }
+
+    // <prefix>_pipe_records_total{pipe="...",direction="in|out"} and friends
+    void registerAs(MetricsRegistry &registry, const std::string &prefix, const char* pipe, bool outgoing) {
+        std::string labels = std::string("pipe=\"") + pipe + "\",direction=\"" + (outgoing ? "out" : "in") + "\"";
+        registry.counter((prefix + "_pipe_records_total").c_str(), "Records moved through the pipe", labels, records);
+        registry.counter((prefix + "_pipe_bytes_total").c_str(), "Bytes moved through the pipe", labels, bytes);
+        if (outgoing)
+            registry.counter((prefix + "_pipe_write_failures_total").c_str(),
+                             "Writes that could not open the pipe or came up short", labels, failures);
+    }
+};
+
+#endif
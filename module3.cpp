@@ -10,20 +10,40 @@
 #include <condition_variable>
 #include <map>
 #include <sys/stat.h> // for mkfifo
+#include <sys/mman.h> // for mmap
+#include <sys/uio.h>  // for writev
+#include <poll.h>     // for poll
+#include <signal.h>   // for SIGPIPE
 #include <fcntl.h>    // for open
 #include <unistd.h>   // for read, write
 #include <errno.h>    // for errno
 #include <string.h>   // for strerror
 #include <array>
+#ifndef ATC_HEADLESS            // Batch builds (-DATC_HEADLESS) need no SFML at all
 #include <SFML/Graphics.hpp>   // For window, shapes, colors, text
 #include <SFML/Window.hpp>     // For window events
 #include <SFML/System.hpp>     // For time, threads, vectors
 #include <SFML/Audio.hpp>      // For sound effects and music
+#endif
 #include <atomic>
 #include <unordered_map>
 #include <unordered_set>
 #include <cmath>
 #include <cstring>   // for strerror
+#include <deque>
+#include <functional>
+#include <memory>
+#include <random>
+#include <cstdint>
+#include <string_view>
+#include <cstdarg>
+#include "avn_protocol.h"
+#include "asset_bundle.h"
+#include "avn_ring.h"
+#include "event_journal.h"
+#include "latency_histogram.h"
+#include "metrics.h"
+#include <sstream>
 
 
 using namespace std;
@@ -44,9 +64,11 @@ const int TAKEOFF_ROLL = 5;
 const int CLIMB = 6;
 const int DEPARTURE = 7;
 
-const int RWY_A = 0;
-const int RWY_B = 1;
-const int RWY_C = 2;
+// Operations a runway of the topology accepts
+const int OP_ARRIVAL = 1;
+const int OP_DEPARTURE = 2;
+const int OP_CARGO = 4;
+const int OP_OVERFLOW = 8;   // arrivals and departures once their own runways are taken
 
 const int DIR_NORTH = 0;
 const int DIR_SOUTH = 1;
@@ -55,6 +77,29 @@ const int DIR_WEST = 3;
 
 const int EMERGENCY_PRIORITY = 999;
 
+// Interval between two lifecycle ticks of a flight (runway retry / speed monitoring)
+const int FLIGHT_TICK_MS = 500;
+// A violation still open after this many ticks is fined and a new episode starts
+const int VIOLATION_EPISODE_MAX_TICKS = 20;
+// Interval between two admission steps of the simulation, and the last admitted time
+const int SIM_STEP_MS = 1000;
+const int SIM_END_TIME = 300;
+// Interval between two published snapshots while a renderer is attached (real time)
+const int SNAPSHOT_PERIOD_MS = 50;
+// The window draws this far behind the newest snapshot's simulation time, so a
+// flight's next position is usually known already and motion is interpolated
+const int RENDER_DELAY_MS = FLIGHT_TICK_MS + SNAPSHOT_PERIOD_MS;
+// Longest a flight keeps moving at its last velocity when no newer position arrives
+const int RENDER_EXTRAPOLATE_MS = FLIGHT_TICK_MS / 2;
+// Frames the frame-time overlay summarises, and how often its text is refreshed
+const int FRAME_STATS_WINDOW = 120;
+const int FRAME_STATS_REFRESH_MS = 250;
+// Journal time one arrow key press moves a replay in the window
+const long long REPLAY_SEEK_STEP_MS = 30000;
+// Asset bundle the window maps from beside the binary, and what --pack-assets puts in it
+const char* ASSET_BUNDLE_FILE = "atc_assets.pak";
+const char* const ASSET_FILES[] = {"airport_bg.jpeg", "runway.png", "plane_icon.png", "Howdy Frog.ttf", "bg_music.ogg"};
+
 // Speed limits structure
 struct SpeedLimit {
     int phase;
@@ -75,19 +120,7 @@ SpeedLimit speedLimits[MAX_PHASES] = {
 };
 
 // AVN structure
-struct AVN {
-    char avnId[100];
-    char flightName[30];
-    char airline[30];
-    int aircraftType;
-    int recordedSpeed;
-    int permissibleSpeed;
-    time_t issueTime;
-    double fineAmount;
-    bool isPaid;
-    time_t dueDate;  // Format: YYYY-MM-DD
-
-};
+typedef AvnRecord AVN;   // the shared binary wire record, see avn_protocol.h
 
 struct PhaseData {
     int timer = 0;
@@ -95,8 +128,21 @@ struct PhaseData {
     int sustainedSpeed = 0;
 };
 
-// Aircraft structure
+// A run of consecutive ticks outside the speed limits of one phase; it is fined
+// once, at the speed furthest outside the limits
+struct ViolationEpisode {
+    int8_t phase = -1;         // -1 while no episode is open
+    int ticks = 0;
+    int peakSpeed = 0;
+    int permissibleSpeed = 0;  // the limit peakSpeed broke
+
+    bool open() const { return phase != -1; }
+};
+
+// Aircraft structure: schedule and display data. The state that changes every tick
+// (phase, speed, runway, flags) lives in flightTable under the aircraft's id.
 struct Aircraft {
+    int id = -1;           // dense index into flightTable
     char flightName[30];
     char airline[30];
     int type;
@@ -104,161 +150,2215 @@ struct Aircraft {
     int airlinenumber;
     int scheduledTime;
     int priority;
-    int phase;
-    bool isAssigned;
-    bool completed;
     int waitingTime;
-    int assignedRunway;
-    char status[50];
-    int speed;
-    bool hasSpeedViolation;
     bool isEmergency=false;
     time_t entryTime;
-     PhaseData phaseData;
     float visualX = 0.f;  // Position for rendering
     std::chrono::steady_clock::time_point phaseStartTime;  // For time-based movement
     std::chrono::steady_clock::time_point waitStartTime;
 
 };
 
-// Runway structure
-struct Runway {
-    int type;
-    bool isAvailable;
-    char currentFlight[30];
+// std::atomic that can be stored in a vector. Copies only happen while the table
+// grows, before any other thread sees it, so a relaxed load is enough.
+template <typename T>
+struct AtomicCell {
+    std::atomic<T> value{};
+
+    AtomicCell() = default;
+    AtomicCell(const AtomicCell &other) : value(other.value.load(std::memory_order_relaxed)) {}
 };
 
-// Global Variables
-vector<Aircraft> arrivalFlights;
-vector<Aircraft> departureFlights;
-Runway runways[3] = {{RWY_A, true, ""}, {RWY_B, true, ""}, {RWY_C, true, ""}};
-vector<AVN> aviationViolationNotices;
+// Per-tick flight state as structure-of-arrays indexed by flight id, so tick loops
+// stream through a few compact arrays instead of whole Aircraft records
+struct FlightTable {
+    vector<int> speed;
+    vector<int8_t> phase;
+    vector<int8_t> type;            // copies of the read-only schedule fields used per tick
+    vector<int8_t> direction;
+    vector<int8_t> assignedRunway;
+    vector<uint8_t> isAssigned;
+    vector<uint8_t> completed;
+    vector<uint8_t> hasSpeedViolation;
+    vector<PhaseData> phaseData;
+    vector<ViolationEpisode> episode;
+    vector<uint32_t> tick;          // ticks advanced so far, the counter of the flight's RNG
+    vector<Aircraft*> record;       // cold data, bound once the flight lists stop growing
+    vector<AtomicCell<uint32_t>> seq;     // odd while a writer is mid-update (seqlock for the snapshot)
+    vector<AtomicCell<uint8_t>> granted;  // set by whichever runway wins the flight
+
+    int add(int flightType, int flightDirection, int initialPhase, int initialSpeed) {
+        int id = (int)speed.size();
+        speed.push_back(initialSpeed);
+        phase.push_back(initialPhase);
+        type.push_back(flightType);
+        direction.push_back(flightDirection);
+        assignedRunway.push_back(-1);
+        isAssigned.push_back(0);
+        completed.push_back(0);
+        hasSpeedViolation.push_back(0);
+        phaseData.push_back(PhaseData());
+        episode.push_back(ViolationEpisode());
+        tick.push_back(0);
+        record.push_back(nullptr);
+        seq.emplace_back();
+        granted.emplace_back();
+        return id;
+    }
+
+    void reserve(size_t n) {
+        speed.reserve(n); phase.reserve(n); type.reserve(n); direction.reserve(n);
+        assignedRunway.reserve(n); isAssigned.reserve(n); completed.reserve(n);
+        hasSpeedViolation.reserve(n); phaseData.reserve(n); episode.reserve(n); tick.reserve(n); record.reserve(n);
+        seq.reserve(n); granted.reserve(n);
+    }
+
+    size_t size() const { return speed.size(); }
+
+    bool isArrival(int id) const { return direction[id] == DIR_NORTH || direction[id] == DIR_SOUTH; }
+
+    // A flight queued on several runways may be picked by two releases at once;
+    // only the first claim succeeds
+    bool claim(int id) {
+        uint8_t expected = 0;
+        return granted[id].value.compare_exchange_strong(expected, 1, std::memory_order_acq_rel);
+    }
+
+    // Writers bracket every change to a row; only the flight's own tick (or the
+    // runway grant while it is parked) writes it, so there is one writer per row
+    void beginWrite(int id) {
+        seq[id].value.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    void endWrite(int id) { seq[id].value.fetch_add(1, std::memory_order_release); }
+};
+
+// Runway structure. The occupant is claimed with a compare-and-swap, so taking a
+// free runway needs no lock; waitMutex only orders queueing for this runway
+// against its release, and is never shared with the other runways.
+struct Runway {
+    char name[16] = "";
+    int ops = 0;                          // OP_* flags from the topology
+    std::atomic<int> currentFlight{-1};   // id of the occupying flight, -1 when free
+    std::mutex waitMutex;
+
+    int occupant() const { return currentFlight.load(std::memory_order_acquire); }
+    bool isAvailable() const { return occupant() < 0; }
+
+    bool tryClaim(int flightId) {
+        int expected = -1;
+        return currentFlight.compare_exchange_strong(expected, flightId, std::memory_order_acq_rel);
+    }
+};
 
-// Synchronization objects
-std::mutex runwayMutex;  // Single mutex for all runways to prevent race conditions
-std::mutex activeMutex;  // Mutex for active flights collection
-std::mutex displayMutex; // Mutex for display operations
-std::mutex avnMutex;     // Mutex for violation notices
-std::condition_variable runwayCV; // Condition variable for runway availability
- std::mutex scheduledMutex;
+// One runway of the airport topology; topology order is the preference order
+struct RunwaySpec {
+    char name[16];
+    int ops;
+};
 
+// One airport of a multi-airport run; empty paths fall back to the command line
+struct AirportSpec {
+    char code[8];
+    char scenario[256];
+    char runways[256];
+};
 
+// Candidate runways of one (direction, type, emergency) class, built once from the
+// topology so a runway request never evaluates the assignment rules
+struct RunwayClass {
+    vector<int> order;       // preference order
+    vector<int> lockOrder;   // the same runways by index, the order the arbiter locks them in
+};
 
 queue<Aircraft>  arrivalQueue;
 queue<Aircraft> departureQueue;
-vector<Aircraft*> activeFlights;
- vector<Aircraft*> flightsForThisMinute;
+
+// Active flights as a slot map: a dense list for iteration plus each flight's slot
+// by id, so membership checks and removals are O(1)
+class ActiveFlightSet {
+public:
+    void insert(Aircraft *flight) {
+        if (flight->id >= (int)slots.size()) slots.resize(flight->id + 1, -1);
+        if (slots[flight->id] != -1) return;
+        slots[flight->id] = (int)dense.size();
+        dense.push_back(flight);
+    }
+
+    // Swap-remove: the last flight takes the freed slot
+    bool erase(int id) {
+        int slot = slotOf(id);
+        if (slot == -1) return false;
+        Aircraft *last = dense.back();
+        dense[slot] = last;
+        slots[last->id] = slot;
+        dense.pop_back();
+        slots[id] = -1;
+        return true;
+    }
+
+    int slotOf(int id) const {
+        return (id >= 0 && id < (int)slots.size()) ? slots[id] : -1;
+    }
+
+    bool contains(int id) const { return slotOf(id) != -1; }
+    void reserveIds(size_t count) { if (count > slots.size()) slots.resize(count, -1); }
+    const vector<Aircraft*>& items() const { return dense; }
+    size_t size() const { return dense.size(); }
+
+private:
+    vector<Aircraft*> dense;
+    vector<int> slots;
+};
 
 std::map<std::string, float> flightFadeMap;  // flightName -> opacity value (0 to 255)
 
 
 // New variables for synchronized processing
 vector<Aircraft*> priorityOrderedFlights;
-std::mutex priorityMutex;
 int currentPriorityIndex = 0;
 
+// SplitMix64: tiny seedable generator, fast enough to synthesize millions of flights
+// per second. Also usable as a URBG for the <random> distributions.
+struct SplitMix64 {
+    using result_type = uint64_t;
+    uint64_t state;
+
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    // The SplitMix64 output function: a strong 64-bit bit mixer on its own
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t operator()() { return mix(state += 0x9E3779B97F4A7C15ULL); }
+
+    // Uniform double in [0, 1)
+    double uniform() { return ((*this)() >> 11) * 0x1.0p-53; }
+
+    // Uniform int in [lo, hi]
+    int range(int lo, int hi) { return lo + (int)(uniform() * (hi - lo + 1)); }
+};
+
+enum RandomStream {
+    RNG_SPEED = 1,         // speed perturbation in monitorSpeed()
+    RNG_GROUND_FAULT = 2   // ground-fault roll in advanceFlight()
+};
+
+// Parameters of a synthetic traffic scenario
+struct TrafficProfile {
+    double flightsPerMinute = 2.0;                  // Poisson mean of new flights per minute
+    int minutes = 300;                              // scheduled times 0 .. minutes-1
+    double typeMix[4] = {0.70, 0.20, 0.05, 0.05};   // COMMERCIAL, CARGO, MILITARY, MEDICAL weights
+    double arrivalShare = 0.5;                      // share of North/South flights
+    int priorityMin = 0;
+    int priorityMax = 999;
+    double emergencyRate = 0.01;                    // extra emergencies among commercial/cargo
+    int surgeStart = -1, surgeEnd = -1;             // minutes [start, end) run at surgeFactor x rate
+    double surgeFactor = 1.0;
+    uint64_t seed = 1;
+
+    // What is wrong with the profile, or NULL; generated flights must load back as a scenario
+    const char* problem() const {
+        if (priorityMin < 0 || priorityMax > 999 || priorityMin > priorityMax)
+            return "--priority-range must be LO,HI with 0 <= LO <= HI <= 999";
+        double mixSum = 0;
+        for (double weight : typeMix) {
+            if (weight < 0) return "--traffic-mix weights must not be negative";
+            mixSum += weight;
+        }
+        if (mixSum <= 0) return "--traffic-mix weights must sum to more than 0";
+        if (arrivalShare < 0 || arrivalShare > 1) return "--arrival-share must be between 0 and 1";
+        if (emergencyRate < 0 || emergencyRate > 1) return "--emergency-rate must be between 0 and 1";
+        if (flightsPerMinute < 0) return "--generate must not be negative";
+        if (minutes < 1) return "--gen-minutes must be at least 1";
+        if (surgeFactor < 0) return "--surge factor must not be negative";
+        return NULL;
+    }
+};
+
+void generateTraffic(const TrafficProfile &profile);
+
 // Declarations
 void getFlightData();
+bool loadScenarioFile(const char* path);
+bool writeScenarioFile(const char* path);
+void prepareFlight(Aircraft &flight, bool emergency);
 void simulateATC();
 void assignToRunway(Aircraft &flight, int runwayIndex);
-void monitorSpeed(Aircraft &flight);
-void checkSpeedViolations(Aircraft &flight);
+void monitorSpeed(int id);
+void checkSpeedViolations(int id);
+void closeViolationEpisode(int id);
+const char* describeStatus(int id, char* buffer, size_t size);
+void fillAVN(AVN &newAVN, const Aircraft &flight, int recordedSpeed, int permissibleSpeed,
+             int number, time_t issueTime);
 void generateAVN(const Aircraft &flight, int recordedSpeed, int permissibleSpeed);
 void handleGroundFault(Aircraft &flight);
+int findFlightId(const char* flightName);
 int findFlightIndex(const char* flightName);
 void displayDashboard(int currentTime);
-void freeRunway(const char* flightName);
+void freeRunway(int flightId);
 const char* getDirectionName(int dir);
 const char* getPhaseName(int phase);
 const char* getAircraftTypeName(int type);
 int findSpeedLimit(int phase);
-void flightLifecycle(Aircraft *flight);
+vector<RunwaySpec> defaultRunwayTopology();
+bool loadRunwayTopology(const char* path, vector<RunwaySpec> &specs);
+bool loadAirportNetwork(const char* path, vector<AirportSpec> &specs);
+bool configureRunways(const vector<RunwaySpec> &specs);
+const char* runwayName(int runwayIndex);
+const RunwayClass& runwayCandidates(const Aircraft *flight);
+bool advanceFlight(Aircraft *flight);
+int flightLifecycle(Aircraft *flight);
 void runSFMLVisualization();
 void createPipeIfNotExists(const char* path);
-void sendExitSignal() ;
+void sendExitSignal(bool waitForReader = true);
 void clearScreen();
 
-class Visualizer {
+// Simulation clock: follows steady_clock by default, or a virtual time that only
+// the event engine advances, so a run is not bound to wall-clock speed
+struct SimClock {
+    bool isVirtual = false;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    time_t originWall = time(NULL);
+    std::atomic<long long> virtualMs{0};
+
+    void start(bool useVirtual) {
+        isVirtual = useVirtual;
+        origin = std::chrono::steady_clock::now();
+        originWall = time(NULL);
+        virtualMs = 0;
+    }
+
+    std::chrono::steady_clock::time_point now() const {
+        if (isVirtual) return origin + std::chrono::milliseconds(virtualMs.load());
+        return std::chrono::steady_clock::now();
+    }
+
+    long long elapsedMs() const {
+        if (isVirtual) return virtualMs;
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    // Calendar time for AVN timestamps
+    time_t wallTime() const {
+        if (isVirtual) return originWall + (time_t)(virtualMs / 1000);
+        return time(NULL);
+    }
+};
+
+class RunwayArbiter;
+
+// Everything one simulated airport owns. Several airports can run in one process
+// (--airports), each driven by its own threads; nothing in here is shared between
+// airports, so shards never contend. Free functions work on the airport of the
+// calling thread, see `airport` below.
+struct Airport {
+    int id = 0;
+    char code[8] = "";                    // empty for a single-airport run
+    uint64_t seed = 1;                    // seed of the flight tick RNG
+    int core = -1;                        // CPU the shard is pinned to, -1 for none
+    SimClock clock;
+    FlightTable flightTable;
+    vector<Aircraft> arrivalFlights;
+    vector<Aircraft> departureFlights;
+    std::unique_ptr<Runway[]> runways;    // sized by configureRunways()
+    int runwayCount = 0;
+    RunwayClass runwayClasses[4][4][2];   // [direction][type][emergency]
+    std::unique_ptr<RunwayArbiter> runwayArbiter;
+    ActiveFlightSet activeFlights;
+    std::mutex activeMutex;               // Mutex for active flights collection
+    // Interned flight names: name -> flight id, built once the flight lists are final
+    std::unordered_map<std::string_view, int> flightIdByName;
+    vector<AVN> aviationViolationNotices;
+    std::mutex avnMutex;                  // Mutex for violation notices
+    std::mutex displayMutex;              // Mutex for this airport's dashboard prints
+    // Run statistics reported in the headless summary
+    std::atomic<int> groundFaultCount{0};
+    std::unique_ptr<JournalWriter> journal;   // set by --journal
+    // Latency split by aircraft type and emergency flag, see latency_histogram.h
+    LatencyBreakdown runwayWait;          // admission to assignToRunway(), simulation time
+    LatencyBreakdown runwayHandoff;       // runway release to the next holder running
+    // Exported through `metrics`, see registerAirportMetrics()
+    MetricCounter flightsAdmitted;
+    MetricCounter flightsCompleted;
+    MetricCounter runwayAssignments;
+    MetricCounter avnsIssued;
+};
+
+vector<std::unique_ptr<Airport>> airports;
+
+// The airport the calling thread simulates; set by main while loading and by each
+// shard's threads when they start
+thread_local Airport *airport = nullptr;
+
+// Counter-based randomness for flight ticks. A draw is a pure function of
+// (airport seed, flight id, tick, stream), so ticks share no generator state, and a
+// run with the same seed replays bit-identically whichever thread runs a tick.
+inline int flightRandom(int flightId, uint32_t tick, int stream, int n) {
+    uint64_t key = SplitMix64::mix(airport->seed + 0x9E3779B97F4A7C15ULL * ((uint64_t)flightId + 1));
+    uint64_t r = SplitMix64::mix(key ^ (((uint64_t)tick << 8) | (uint64_t)stream));
+    return (int)(((r >> 32) * (uint64_t)n) >> 32);
+}
+
+// Record a state change of the calling thread's airport, if it keeps a journal
+inline void journalEvent(int type, int flightId, int arg = 0, int a = 0, int b = 0) {
+    if (airport->journal) airport->journal->append(type, flightId, arg, a, b);
+}
+
+// Pin the calling thread to the airport's core, if it has one
+void enterAirport(Airport *home) {
+    airport = home;
+    if (home->core < 0) return;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(home->core, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+enum LogLevel { LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR, LOG_OFF };
+
+// Asynchronous logger for the flight hot path. Each thread formats its lines into
+// its own single-producer ring; a background thread drains all rings every few ms,
+// orders the batch by time and writes it with one call. A log call therefore costs
+// a vsnprintf, with no syscall and no lock shared with other threads.
+// A ring passing half full wakes the drain thread early; a line that finds its
+// ring full is dropped and counted rather than stalling the caller, and the drain
+// thread reports the count. Errors go to stderr, everything else to stdout.
+class AsyncLogger {
+public:
+    static const uint32_t RING_SIZE = 1024;   // lines per thread, power of two
+    static const int TEXT_SIZE = 112;
+
+    void setLevel(int level) { minLevel = level; }
+    bool enabled(int level) const { return level >= minLevel.load(std::memory_order_relaxed); }
+
+    void start() {
+        running = true;
+        drainer = std::thread(&AsyncLogger::drainLoop, this);
+    }
+
+    // Drain what is left and write synchronously from here on
+    void stop() {
+        if (!drainer.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wakeCV.notify_one();
+        drainer.join();
+        running = false;
+        drain();
+    }
+
+    void log(int level, const char* fmt, ...) __attribute__((format(printf, 3, 4))) {
+        if (!enabled(level)) return;
+
+        Record local;
+        Ring *ring = running ? &localRing() : nullptr;
+        uint32_t head = 0;
+        Record *rec = &local;
+        if (ring) {
+            head = ring->head.load(std::memory_order_relaxed);
+            uint32_t used = head - ring->tail.load(std::memory_order_acquire);
+            if (used >= RING_SIZE) {
+                ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+            if (used == RING_SIZE / 2) wakeDrainer();
+            rec = &ring->slots[head & (RING_SIZE - 1)];
+        }
+
+        rec->wallNs = std::chrono::steady_clock::now().time_since_epoch().count();
+        // Threads outside any airport (the emitter) log on the clock of a lone airport
+        const Airport *home = airport ? airport : (airports.size() == 1 ? airports[0].get() : nullptr);
+        rec->simMs = home ? home->clock.elapsedMs() : 0;
+        snprintf(rec->airport, sizeof(rec->airport), "%s", home ? home->code : "");
+        rec->level = level;
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(rec->text, TEXT_SIZE, fmt, args);
+        va_end(args);
+
+        if (ring) {
+            ring->head.store(head + 1, std::memory_order_release);
+        } else {
+            // Not started (or already stopped): write straight through
+            std::string line;
+            format(*rec, line);
+            fputs(line.c_str(), level >= LOG_ERROR ? stderr : stdout);
+        }
+    }
+
+    // Lines lost to full rings so far
+    unsigned long long droppedCount() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        unsigned long long total = 0;
+        for (auto &ring : rings) total += ring->dropped.load(std::memory_order_relaxed);
+        return total;
+    }
+
 private:
-    sf::RenderWindow window;
-    sf::Font font;
-    sf::Clock simClock;
-    int currentTime = 0;
-    std::chrono::steady_clock::time_point currStartTime;
-    int scheduledIndex = 0;
-    vector<Aircraft*> scheduledFlights;
-    vector<std::thread> flightThreads;
-    std::atomic<bool> simulationRunning{true};
-    sf::Texture airportTexture;
-    sf::Sprite airportSprite;
-    sf::Texture runwayTexture;
-    sf::Sprite runwaySpriteTemplate;
-    sf::Texture flightTexture;
-    sf::Sprite flightSpriteTemplate;
+    struct Record {
+        long long wallNs;
+        long long simMs;
+        int level;
+        char airport[8];
+        char text[TEXT_SIZE];
+    };
+
+    struct Ring {
+        std::atomic<uint32_t> head{0};   // written by the owning thread
+        std::atomic<uint32_t> tail{0};   // written by the drain thread
+        std::atomic<unsigned long long> dropped{0};   // written by the owning thread
+        Record slots[RING_SIZE];
+    };
+
+    std::atomic<int> minLevel{LOG_INFO};
+    std::atomic<bool> running{false};
+    std::atomic<bool> stopping{false};
+    std::thread drainer;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCV;
+    bool wakeRequested = false;           // under wakeMutex
+    std::mutex registryMutex;             // taken once per thread, on its first line
+    vector<std::unique_ptr<Ring>> rings;
+    vector<Record> batch;                 // drain thread only
+    unsigned long long reportedDrops = 0; // drain thread only
+
+    void wakeDrainer() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakeRequested = true;
+        }
+        wakeCV.notify_one();
+    }
+
+    Ring& localRing() {
+        thread_local Ring *ring = nullptr;
+        if (!ring) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            rings.emplace_back(new Ring());
+            ring = rings.back().get();
+        }
+        return *ring;
+    }
+
+    static void format(const Record &rec, std::string &out) {
+        static const char* names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+        char prefix[48];
+        snprintf(prefix, sizeof(prefix), "[T+%lld.%03llds] %-5s %s%s", rec.simMs / 1000, rec.simMs % 1000,
+                 names[rec.level], rec.airport, rec.airport[0] ? " " : "");
+        out += prefix;
+        out += rec.text;
+        out += '\n';
+    }
+
+    // Move every pending line out of the rings and write them; false if none
+    bool drain() {
+        batch.clear();
+        unsigned long long drops = 0;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (auto &ring : rings) {
+                uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+                uint32_t head = ring->head.load(std::memory_order_acquire);
+                for (; tail != head; tail++)
+                    batch.push_back(ring->slots[tail & (RING_SIZE - 1)]);
+                ring->tail.store(tail, std::memory_order_release);
+                drops += ring->dropped.load(std::memory_order_relaxed);
+            }
+        }
+        if (drops > reportedDrops) {
+            Record note = {};
+            note.wallNs = std::chrono::steady_clock::now().time_since_epoch().count();
+            note.simMs = batch.empty() ? 0 : batch.back().simMs;
+            note.level = LOG_WARN;
+            snprintf(note.text, TEXT_SIZE, "%llu log lines dropped on full rings", drops - reportedDrops);
+            batch.push_back(note);
+            reportedDrops = drops;
+        }
+        if (batch.empty()) return false;
+
+        std::stable_sort(batch.begin(), batch.end(), [](const Record &a, const Record &b) {
+            return a.wallNs < b.wallNs;
+        });
+        std::string out, err;
+        for (const Record &rec : batch)
+            format(rec, rec.level >= LOG_ERROR ? err : out);
+        if (!out.empty()) { fwrite(out.data(), 1, out.size(), stdout); fflush(stdout); }
+        if (!err.empty()) { fwrite(err.data(), 1, err.size(), stderr); }
+        return true;
+    }
+
+    void drainLoop() {
+        while (!stopping) {
+            if (drain()) continue;
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCV.wait_for(lock, std::chrono::milliseconds(5), [this]() { return wakeRequested || stopping; });
+            wakeRequested = false;
+        }
+    }
+};
+
+AsyncLogger logger;
 
+// Counters and gauges written to METRICS_DIR/atc.prom, see metrics.h
+MetricsRegistry metrics;
+
+// Sends AVN records to the AVN generator over the FIFO from one emitter thread.
+// Flight threads hand records over through a bounded lock-free queue and never
+// touch the pipe. The emitter keeps the descriptor open across AVNs, coalesces
+// queued records into writev() batches, and reconnects when the reader comes
+// back. While the reader is down it keeps at most BACKLOG_LIMIT records,
+// dropping the oldest.
+class AvnEmitter {
 public:
-    Visualizer() : window(sf::VideoMode(1400, 1000), "ATC Simulation") {
-        window.setFramerateLimit(60);
-        if (!font.loadFromFile("Howdy Frog.ttf")) {
-            std::cerr << "Failed to load font.\n";
+    static const size_t QUEUE_SIZE = 4096;      // power of two
+    static const size_t BACKLOG_LIMIT = 65536;  // records held while no reader is attached
+    static const int IDLE_WAIT_MS = 200;        // emitter sleep with nothing to send
+    static const int RECORD_SIZE = sizeof(AvnRecord);
+
+    AvnEmitter() : cells(QUEUE_SIZE) {
+        for (size_t i = 0; i < QUEUE_SIZE; i++) cells[i].seq = i;
+    }
+
+    // useRing=false keeps to the FIFO even when an AVN generator offers its ring
+    void start(const char* pipePath, bool useRing = true) {
+        path = pipePath;
+        ringAllowed = useRing;
+        signal(SIGPIPE, SIG_IGN);   // a reader going away must not kill the controller
+
+        // A restarted emitter (the benchmarks) begins empty
+        Record stale;
+        while (pop(stale)) {}
+        spill.clear();
+        spilling = false;
+        backlog.clear();
+        partial = 0;
+        sent = 0;
+        dropped = 0;
+        stopping = false;
+        emitter = std::thread(&AvnEmitter::run, this);
+    }
+
+    // True while the shared-memory ring is the transport; the exit record then goes
+    // through the ring behind the last AVN instead of through the FIFO
+    bool sendsExitOverRing() const { return onRing; }
+
+    long long droppedCount() const { return dropped; }
+
+    void registerMetrics() {
+        const char* transports[] = {"transport=\"pipe\"", "transport=\"ring\""};
+        for (int t = 0; t < 2; t++) {
+            metrics.counter("atc_avn_records_sent_total", "AVN records handed to the AVN generator",
+                            transports[t], recordsSent[t]);
+            metrics.counter("atc_avn_bytes_sent_total", "AVN bytes handed to the AVN generator",
+                            transports[t], bytesSent[t]);
         }
-        currStartTime = std::chrono::steady_clock::now();
+        metrics.counter("atc_avn_pipe_write_failures_total", "AVN pipe writes that lost the reader", "", writeFailures);
+        metrics.counter("atc_avn_pipe_full_total", "AVN pipe writes deferred because the pipe was full", "", pipeFull);
+        metrics.counter("atc_avn_dropped_total", "AVN records dropped on a full queue or backlog", "",
+                        [this]() { return (double)dropped; });
+        metrics.gauge("atc_avn_queue_depth", "AVN records queued for the emitter thread", "",
+                      [this]() { return (double)(enqueuePos.load(std::memory_order_relaxed) - dequeuePos.load(std::memory_order_relaxed)); });
+        metrics.gauge("atc_avn_backlog_depth", "AVN records waiting for the AVN generator to read", "",
+                      [this]() { return (double)backlogDepth.load(std::memory_order_relaxed); });
+    }
 
-        for (auto &f : arrivalFlights)
+    // Flush what is left to a connected reader, then close
+    void stop() {
+        if (!emitter.joinable()) return;
         {
-             f.waitStartTime = std::chrono::steady_clock::now();
-            scheduledFlights.push_back(&f);
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        emitter.join();
+        long long lost = dropped + (long long)backlog.size();
+        logger.log(lost ? LOG_WARN : LOG_INFO, "AVN emitter: %lld records sent, %lld dropped", sent, lost);
+    }
+
+    // Lock-free multi-producer enqueue (Vyukov bounded queue). A full queue spills
+    // into a locked overflow list instead; a record is only dropped there, and only
+    // while no reader is attached and BACKLOG_LIMIT records are already held.
+    bool push(const void* data, size_t len) {
+        if (len > RECORD_SIZE) len = RECORD_SIZE;
+        // Once spilling, later records follow the spilled ones to keep their order
+        if (spilling.load(std::memory_order_acquire)) return pushSpill(data, len);
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &cells[pos & (QUEUE_SIZE - 1)];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst))
+                    break;
+            } else if (diff < 0) {
+                return pushSpill(data, len);
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
             }
-        for (auto &f : departureFlights)
+        }
+        memcpy(cell->record.data, data, len);
+        cell->record.len = (uint16_t)len;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        // Empty to non-empty: the emitter may be asleep. Taking the mutex orders this
+        // against its check of the queue, so the wakeup cannot fall in between.
+        if (dequeuePos.load(std::memory_order_seq_cst) == pos) {
+            { std::lock_guard<std::mutex> lock(wakeMutex); }
+            wake.notify_one();
+        }
+        return true;
+    }
+
+private:
+    struct Record {
+        uint16_t len;
+        char data[RECORD_SIZE];
+    };
+
+    struct Cell {
+        std::atomic<size_t> seq;
+        Record record;
+
+        Cell() = default;
+        Cell(const Cell &) : seq(0) {}
+    };
+
+    vector<Cell> cells;
+    std::atomic<size_t> enqueuePos{0};
+    std::atomic<size_t> dequeuePos{0};  // written by the emitter only
+    std::mutex wakeMutex;               // guards spill and the emitter's sleep
+    std::condition_variable wake;
+    std::deque<Record> spill;           // records that found the queue full
+    std::atomic<bool> spilling{false};
+    std::atomic<bool> readerAttached{false};
+    std::deque<Record> backlog;         // emitter only
+    size_t partial = 0;                 // bytes of backlog.front() already written
+    int fd = -1;
+    const char* path = nullptr;
+    AvnRing ring;                       // used instead of fd when avn2 runs with --shm
+    bool ringAllowed = true;
+    std::atomic<bool> onRing{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<long long> dropped{0};
+    long long sent = 0;
+    std::thread emitter;
+    MetricCounter recordsSent[2];       // [pipe, ring]
+    MetricCounter bytesSent[2];
+    MetricCounter writeFailures;
+    MetricCounter pipeFull;
+    std::atomic<size_t> backlogDepth{0};
+
+    bool pop(Record &out) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell &cell = cells[pos & (QUEUE_SIZE - 1)];
+        if (cell.seq.load(std::memory_order_acquire) != pos + 1) return false;
+        out = cell.record;
+        cell.seq.store(pos + QUEUE_SIZE, std::memory_order_release);
+        dequeuePos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool pushSpill(const void* data, size_t len) {
         {
-                 f.waitStartTime = std::chrono::steady_clock::now();
-            scheduledFlights.push_back(&f);
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            if (!readerAttached.load(std::memory_order_relaxed) &&
+                spill.size() + backlogDepth.load(std::memory_order_relaxed) >= BACKLOG_LIMIT) {
+                dropped++;
+                return false;
             }
-        sort(scheduledFlights.begin(), scheduledFlights.end(), [](Aircraft* a, Aircraft* b) {
-            return a->scheduledTime < b->scheduledTime;
-        });
-        
-        
-               if (!airportTexture.loadFromFile("/home/huma-taj/Downloads/airport_bg.jpeg")) {
-                    std::cerr << "Failed to load airport background.\n";
-                    }
-          airportSprite.setTexture(airportTexture);
-          // Set dimmed transparency (alpha) to the background
-          sf::Vector2u textureSize = airportTexture.getSize();
-          sf::Vector2u windowSize = window.getSize();
-          float scaleX = static_cast<float>(windowSize.x) / textureSize.x;
-          float scaleY = static_cast<float>(windowSize.y) / textureSize.y;
-          airportSprite.setScale(scaleX, scaleY);
-          airportSprite.setColor(sf::Color(255, 255, 255, 80));  // Still dim
+            spill.emplace_back();
+            Record &record = spill.back();
+            memcpy(record.data, data, len);
+            record.len = (uint16_t)len;
+            spilling.store(true, std::memory_order_release);
+        }
+        wake.notify_one();
+        return true;
+    }
+
+    // Anything for the emitter to pick up; called with wakeMutex held
+    bool pending() const {
+        return stopping || spilling.load(std::memory_order_relaxed) ||
+               enqueuePos.load(std::memory_order_seq_cst) != dequeuePos.load(std::memory_order_relaxed);
+    }
+
+    // Move the queue, then the spilled records behind it, into the backlog. Without
+    // a reader the oldest records past the limit are dropped; with one the backlog
+    // holds everything until it is written.
+    void collect() {
+        Record record;
+        while (pop(record)) {
+            admit(record);
+        }
+        if (!spilling.load(std::memory_order_acquire)) return;
+        std::deque<Record> spilled;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            // Records that got into the queue before the spill started go first
+            while (pop(record)) admit(record);
+            spilled.swap(spill);
+            spilling.store(false, std::memory_order_release);
+        }
+        for (const Record &r : spilled) admit(r);
+    }
+
+    void admit(const Record &record) {
+        if (!connected() && backlog.size() >= BACKLOG_LIMIT) {
+            backlog.pop_front();
+            partial = 0;
+            dropped++;
+        }
+        backlog.push_back(record);
+    }
+
+    bool connected() const { return fd != -1 || ring.attached(); }
+
+    // Prefer the shared-memory ring; the FIFO is the fallback
+    bool connect() {
+        partial = 0;    // a new reader starts on a record boundary
+        if (ringAllowed && ring.attach(AVN_RING_NAME)) {
+            onRing = true;
+            logger.log(LOG_INFO, "AVN emitter attached to shared-memory ring %s", AVN_RING_NAME);
+            return true;
+        }
+        fd = open(path, O_WRONLY | O_NONBLOCK);
+        if (fd != -1) {
+            logger.log(LOG_INFO, "AVN emitter connected to %s", path);
+            return true;
+        }
+        return false;
+    }
+
+    // Copy as much of the backlog as the ring takes; false if its reader has exited
+    bool flushRing() {
+        while (!backlog.empty()) {
+            AvnRecord batch[64];
+            size_t count = 0;
+            for (auto it = backlog.begin(); it != backlog.end() && count < 64; ++it, ++count)
+                memcpy(&batch[count], it->data, sizeof(AvnRecord));
+            size_t n = ring.write(batch, count);
+            backlog.erase(backlog.begin(), backlog.begin() + n);
+            sent += n;
+            recordsSent[1].add(n);
+            bytesSent[1].add(n * sizeof(AvnRecord));
+            if (n < count) {
+                if (ring.readerAlive()) return true;  // ring full, retry later
+                logger.log(LOG_WARN, "AVN ring reader went away, buffering");
+                ring.detach();
+                onRing = false;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Write as much of the backlog as the pipe takes; false if the reader went away
+    bool flush() {
+        if (ring.attached()) return flushRing();
+        while (!backlog.empty()) {
+            struct iovec iov[64];
+            int count = 0;
+            for (auto it = backlog.begin(); it != backlog.end() && count < 64; ++it, ++count) {
+                size_t skip = (count == 0) ? partial : 0;
+                iov[count].iov_base = it->data + skip;
+                iov[count].iov_len = it->len - skip;
+            }
+            ssize_t n = writev(fd, iov, count);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EINTR) {
+                    pipeFull.add();
+                    return true;  // pipe full, retry later
+                }
+                writeFailures.add();
+                logger.log(LOG_WARN, "AVN reader went away (%s), buffering", strerror(errno));
+                close(fd);
+                fd = -1;
+                return false;
+            }
+            bytesSent[0].add(n);
+            while (n > 0) {
+                size_t left = backlog.front().len - partial;
+                if ((size_t)n < left) {
+                    partial += n;
+                    break;
+                }
+                n -= left;
+                partial = 0;
+                backlog.pop_front();
+                sent++;
+                recordsSent[0].add();
+            }
+            if (partial) return true;  // pipe full mid-record
+        }
+        return true;
+    }
+
+    void run() {
+        auto nextConnect = std::chrono::steady_clock::now();
+        bool warned = false;
+        while (!stopping) {
+            collect();
+            if (!connected() && !backlog.empty() && std::chrono::steady_clock::now() >= nextConnect) {
+                if (!connect()) {
+                    if (!warned) logger.log(LOG_ERROR, "Could not open pipe for writing: %s; buffering AVNs", strerror(errno));
+                    warned = true;
+                    nextConnect = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+                } else {
+                    warned = false;
+                }
+            }
+            if (connected()) flush();
+            readerAttached.store(connected(), std::memory_order_relaxed);
+            backlogDepth.store(backlog.size(), std::memory_order_relaxed);
+
+            // Sleep until a producer wakes us; poll a full pipe or a pending
+            // reconnect every 2 ms
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(backlog.empty() ? IDLE_WAIT_MS : 2),
+                          [this]() { return pending(); });
+        }
+
+        // Final flush, only if a reader is attached; give up once it stops reading
+        // for two seconds
+        collect();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        if (!connected() && !backlog.empty()) connect();
+        while (connected() && !backlog.empty() && std::chrono::steady_clock::now() < deadline) {
+            long long before = sent;
+            if (!flush()) break;
+            if (sent != before) deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+            if (!backlog.empty()) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        backlogDepth.store(backlog.size(), std::memory_order_relaxed);
+        if (ring.attached()) {
+            AvnRecord exitRecord;
+            avnInit(exitRecord, AVN_MSG_EXIT);
+            if (ring.write(&exitRecord, 1) == 0) onRing = false;  // full: fall back to the FIFO
+            ring.detach();
+        }
+        if (fd != -1) close(fd);
+        fd = -1;
+    }
+};
+
+AvnEmitter avnEmitter;
+
+// Central runway arbiter. A flight that finds no free runway waits in the queue of
+// every runway it may use; a released runway is handed straight to the best waiting
+// flight (emergency first, then priority, then entry time) instead of being polled for.
+class RunwayArbiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Wakes a flight that was handed a runway while parked
+    std::function<void(Aircraft*, Clock::time_point)> onGrant;
+
+    // Assign the first free runway in the flight's preference order, or queue it
+    bool request(Aircraft *flight) {
+        const RunwayClass &candidates = runwayCandidates(flight);
+
+        // Fast path: claim a free runway without taking any lock
+        for (int r : candidates.order) {
+            if (tryGrant(flight, r))
+                return true;
+        }
 
+        // Slow path: lock only the candidate runways, in index order so two requests
+        // cannot deadlock. A release takes the same per-runway lock, so a runway
+        // freed between the fast path and the queueing below is still seen here.
+        for (int r : candidates.lockOrder)
+            airport->runways[r].waitMutex.lock();
+
+        bool granted = false;
+        for (size_t k = 0; k < candidates.order.size() && !granted; k++)
+            granted = tryGrant(flight, candidates.order[k]);
+        if (!granted) {
+            long long seq = nextSeq++;
+            for (int r : candidates.order)
+                waiting[r].push({flight, seq});
+        }
+
+        for (auto it = candidates.lockOrder.rbegin(); it != candidates.lockOrder.rend(); ++it)
+            airport->runways[*it].waitMutex.unlock();
+        return granted;
+    }
+
+    // Called with runway i's waitMutex held by its occupant on release. Ownership
+    // passes straight to the best queued flight, so a runway with waiters is never
+    // seen free; returns the flight it went to, or nullptr if it is now free.
+    Aircraft* handOff(int runwayIndex) {
+        auto &queue = waiting[runwayIndex];
+        while (!queue.empty()) {
+            Aircraft *next = queue.top().flight;
+            queue.pop();
+            if (!airport->flightTable.claim(next->id)) continue;  // already granted another runway
+            airport->runways[runwayIndex].currentFlight.store(next->id, std::memory_order_release);
+            grant(next, runwayIndex);
+            return next;
+        }
+        airport->runways[runwayIndex].currentFlight.store(-1, std::memory_order_release);
+        return nullptr;
+    }
+
+    // One wait queue per runway of the topology; called before any request
+    void configure(int count) { waiting.assign(count, std::priority_queue<WaitEntry>()); }
+
+    // Time from a runway release until the granted flight runs again
+    void recordHandoff(const Aircraft *flight, Clock::time_point releasedAt) {
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - releasedAt).count();
+        airport->runwayHandoff.record(flight->type, flight->isEmergency, ns);
+        handoffs++;
+        handoffTotalNs += ns;
+        long long prev = handoffMaxNs;
+        while (ns > prev && !handoffMaxNs.compare_exchange_weak(prev, ns)) {}
+    }
+
+    long long handoffCount() const { return handoffs; }
+    double avgHandoffUs() const { return handoffs ? handoffTotalNs / 1000.0 / handoffs : 0.0; }
+    double maxHandoffUs() const { return handoffMaxNs / 1000.0; }
+
+private:
+    struct WaitEntry {
+        Aircraft *flight;
+        long long seq;
+
+        // priority_queue puts the "largest" on top, so this is "a ranks below b"
+        bool operator<(const WaitEntry &other) const {
+            const Aircraft *a = flight, *b = other.flight;
+            if (a->isEmergency != b->isEmergency) return !a->isEmergency;
+            if (a->priority != b->priority) return a->priority < b->priority;
+            if (a->entryTime != b->entryTime) return a->entryTime > b->entryTime;
+            return seq > other.seq;
+        }
+    };
+
+    vector<std::priority_queue<WaitEntry>> waiting;   // waiting[i] is guarded by runways[i].waitMutex
+    std::atomic<long long> nextSeq{0};
+    std::atomic<long long> handoffs{0};
+    std::atomic<long long> handoffTotalNs{0};
+    std::atomic<long long> handoffMaxNs{0};
+
+    // Claim runway i for a flight that is not queued anywhere yet
+    bool tryGrant(Aircraft *flight, int runwayIndex) {
+        if (!airport->runways[runwayIndex].tryClaim(flight->id))
+            return false;
+        airport->flightTable.claim(flight->id);
+        grant(flight, runwayIndex);
+        return true;
+    }
+
+    void grant(Aircraft *flight, int runwayIndex) {
+        auto now = airport->clock.now();
+        flight->waitingTime = std::chrono::duration_cast<std::chrono::seconds>(now - flight->waitStartTime).count();
+        assignToRunway(*flight, runwayIndex);
+        logger.log(LOG_INFO, "SUCCESS: Flight %s (priority %d) assigned to runway %s",
+                   flight->flightName, flight->priority, airport->runways[runwayIndex].name);
+    }
+};
+
+// Discrete events driving the virtual-clock mode
+enum SimEventType {
+    EV_SIM_STEP,        // admission of the flights scheduled for the current minute
+    EV_RUNWAY_REQUEST,  // flight asks for a runway
+    EV_FLIGHT_TICK,     // speed monitoring and phase change of an assigned flight
+    EV_RUNWAY_RELEASE   // flight leaves its runway
+};
+
+struct SimEvent {
+    long long timeMs;
+    long long seq;       // insertion order, keeps same-time events FIFO
+    int type;
+    Aircraft *flight;
+
+    bool operator>(const SimEvent &other) const {
+        if (timeMs != other.timeMs) return timeMs > other.timeMs;
+        return seq > other.seq;
+    }
+};
+
+// Timestamped event queue; popping an event moves the virtual clock to its time
+class EventEngine {
+public:
+    void schedule(long long atMs, int type, Aircraft *flight = nullptr) {
+        events.push({atMs, nextSeq++, type, flight});
+    }
+
+    void scheduleIn(long long delayMs, int type, Aircraft *flight = nullptr) {
+        schedule(nowMs + delayMs, type, flight);
+    }
+
+    bool empty() const { return events.empty(); }
+
+    SimEvent pop() {
+        SimEvent ev = events.top();
+        events.pop();
+        nowMs = ev.timeMs;
+        airport->clock.virtualMs = nowMs;
+        processed++;
+        return ev;
+    }
+
+    long long now() const { return nowMs; }
+    long long processedCount() const { return processed; }
+
+private:
+    std::priority_queue<SimEvent, vector<SimEvent>, std::greater<SimEvent>> events;
+    long long nextSeq = 0;
+    long long nowMs = 0;
+    long long processed = 0;
+};
+
+// Fixed-size work-stealing pool that runs flight lifecycles as resumable tasks.
+// A task returns the delay in ms before it wants to run again, or -1 when finished,
+// so a flight waiting between ticks costs a heap entry instead of an OS thread.
+// A task queued by a worker goes on that worker's own deque, which it runs LIFO;
+// a worker whose deque is empty steals FIFO from the others, and only a worker
+// that finds nothing anywhere sleeps, on its own condition variable.
+// Delayed tasks likewise go on the scheduling worker's own timer heap, which that
+// worker drains when they fall due (others take them only when idle), so a flight
+// tick takes no lock shared by the whole pool.
+class FlightWorkerPool {
+public:
+    using Task = std::function<int()>;
+
+    // threadInit runs first on every pool thread (e.g. to bind it to an airport)
+    explicit FlightWorkerPool(unsigned workerCount = std::max(2u, std::thread::hardware_concurrency()),
+                              std::function<void()> threadInit = nullptr)
+        : queues(workerCount), sleepers(workerCount) {
+        for (unsigned i = 0; i < workerCount; i++)
+            workers.emplace_back([this, i, threadInit]() {
+                if (threadInit) threadInit();
+                workerLoop(i);
+            });
+    }
+
+    ~FlightWorkerPool() {
+        shutdown();
+    }
+
+    // A task that returns TASK_PARKED leaves the pool but stays live; whoever holds it
+    // (e.g. the runway arbiter) brings it back with resume()
+    static const int TASK_PARKED = -2;
+
+    // Run a task as soon as a worker is free
+    void submit(Task task) {
+        beginTask();
+        resume(std::move(task));
+    }
+
+    // Run a task after delayMs milliseconds
+    void submitAfter(int delayMs, Task task) {
+        beginTask();
+        resumeAfter(delayMs, std::move(task));
+    }
+
+    // Count a task as live before its first step runs outside the pool
+    void beginTask() {
+        liveTasks++;
+    }
+
+    void endTask() {
+        if (--liveTasks == 0) {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            idleCV.notify_all();
+        }
+    }
+
+    // Hand back a task that is already counted as live
+    void resume(Task task) {
+        enqueue(std::move(task));
+    }
+
+    void resumeAfter(int delayMs, Task task) {
+        schedule(delayMs, std::move(task));
+    }
+
+    // Block until every submitted task has finished
+    void waitAll() {
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idleCV.wait(lock, [this]() { return liveTasks == 0 || stopping; });
+    }
+
+    void shutdown() {
+        if (stopping.exchange(true)) return;
+        // Take each mutex once so no waiter can miss the flag between its check and its wait
+        { std::lock_guard<std::mutex> lock(idleMutex); }
+        idleCV.notify_all();
+        for (Sleeper &sleeper : sleepers) {
+            { std::lock_guard<std::mutex> lock(sleeper.mutex); }
+            sleeper.cv.notify_one();
+        }
+        for (auto &t : workers) t.join();
+    }
+
+    size_t workerCount() const { return workers.size(); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct DelayedTask {
+        Clock::time_point due;
+        Task task;
+        bool operator>(const DelayedTask &other) const { return due > other.due; }
+    };
+
+    // A worker's ready tasks and its timer heap, under one lock
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::priority_queue<DelayedTask, vector<DelayedTask>, std::greater<DelayedTask>> delayed;
+    };
+
+    struct Sleeper {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool woken = false;
+    };
+
+    std::vector<WorkerQueue> queues;
+    std::vector<Sleeper> sleepers;
+    std::vector<std::thread> workers;
+    std::atomic<unsigned> nextQueue{0};        // for tasks queued from outside the pool
+    std::atomic<int> liveTasks{0};
+    std::atomic<bool> stopping{false};
+
+    // Workers asleep or about to sleep; only touched when one runs out of work
+    std::mutex sleepMutex;
+    vector<unsigned> asleep;
+    std::atomic<int> asleepCount{0};
+
+    // The pool and worker index of the calling thread, if it is a pool worker
+    static thread_local FlightWorkerPool *currentPool;
+    static thread_local unsigned currentWorker;
+    std::mutex idleMutex;
+    std::condition_variable idleCV;
+
+    // A worker queues on its own deque; other threads spread tasks round-robin.
+    // A sleeping worker is woken only if there is one.
+    void enqueue(Task task) {
+        unsigned target = currentPool == this ? currentWorker : nextQueue++ % queues.size();
+        {
+            WorkerQueue &q = queues[target];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(std::move(task));
+        }
+        // Pairs with the fence in workerLoop(): either this sees the sleeper, or the
+        // sleeper's last scan sees the task
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (asleepCount.load(std::memory_order_relaxed) > 0) wakeOne();
+    }
+
+    void wakeOne() {
+        unsigned worker;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            if (asleep.empty()) return;
+            worker = asleep.back();
+            asleep.pop_back();
+            asleepCount--;
+        }
+        wake(worker);
+    }
+
+    void wake(unsigned worker) {
+        Sleeper &sleeper = sleepers[worker];
+        {
+            std::lock_guard<std::mutex> lock(sleeper.mutex);
+            sleeper.woken = true;
+        }
+        sleeper.cv.notify_one();
+    }
+
+    // Drop a worker from the sleeper list; false if a waker already took it off
+    bool unregisterSleeper(unsigned self) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        auto it = std::find(asleep.begin(), asleep.end(), self);
+        if (it == asleep.end()) return false;
+        asleep.erase(it);
+        asleepCount--;
+        return true;
+    }
+
+    // A worker puts the task on its own timer heap and needs no wakeup, as it is
+    // awake. Other threads spread tasks round-robin and wake the owner only if the
+    // task is now its earliest and it sleeps, since its sleep ends at that deadline.
+    void schedule(int delayMs, Task task) {
+        bool fromWorker = currentPool == this;
+        unsigned target = fromWorker ? currentWorker : nextQueue++ % queues.size();
+        auto due = Clock::now() + std::chrono::milliseconds(delayMs);
+        bool earliest;
+        {
+            WorkerQueue &q = queues[target];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.delayed.push({due, std::move(task)});
+            earliest = q.delayed.top().due == due;
+        }
+        if (fromWorker || !earliest) return;
+        // The sleeper list is checked under its mutex: a worker registering after
+        // this finds the task when it computes its deadline
+        if (unregisterSleeper(target)) wake(target);
+    }
+
+    // Move the task off q's timer heap if it is due; called with q's mutex held
+    static bool popDue(WorkerQueue &q, Clock::time_point now, Task &out) {
+        if (q.delayed.empty() || q.delayed.top().due > now) return false;
+        out = std::move(const_cast<DelayedTask &>(q.delayed.top()).task);
+        q.delayed.pop();
+        return true;
+    }
+
+    // Due timers first, then the own deque LIFO for locality; other workers' queues
+    // are robbed FIFO, and their due timers taken when they have no ready tasks
+    bool takeTask(unsigned self, Task &out) {
+        auto now = Clock::now();
+        {
+            WorkerQueue &own = queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (popDue(own, now, out)) return true;
+            if (!own.tasks.empty()) {
+                out = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); k++) {
+            WorkerQueue &victim = queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                out = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+            if (popDue(victim, now, out)) return true;
+        }
+        return false;
+    }
+
+    // Deadline of the worker's earliest timer, Clock::time_point::max() if it has none
+    Clock::time_point nextDue(unsigned self) {
+        WorkerQueue &own = queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        return own.delayed.empty() ? Clock::time_point::max() : own.delayed.top().due;
+    }
+
+    // Sleep until an enqueue picks this worker or its earliest timer falls due;
+    // false once the pool is stopping
+    bool sleep(unsigned self, Task &task) {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            asleep.push_back(self);
+            asleepCount++;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // A task queued just before we registered is found by this last scan
+        bool found = !stopping && takeTask(self, task);
+        if (stopping || found) {
+            // If a waker already picked us, its task is still queued and is found on
+            // our next scan, so its wakeup is not lost
+            unregisterSleeper(self);
+            return found;
+        }
+        auto due = nextDue(self);
+        {
+            Sleeper &sleeper = sleepers[self];
+            std::unique_lock<std::mutex> lock(sleeper.mutex);
+            auto woken = [&]() { return sleeper.woken || stopping; };
+            if (due == Clock::time_point::max())
+                sleeper.cv.wait(lock, woken);
+            else
+                sleeper.cv.wait_until(lock, due, woken);
+            sleeper.woken = false;
+        }
+        // A timeout leaves us on the list; a stale wakeup only costs one more scan
+        unregisterSleeper(self);
+        return !stopping;
+    }
+
+    void workerLoop(unsigned self) {
+        currentPool = this;
+        currentWorker = self;
+        while (true) {
+            Task task;
+            if (!takeTask(self, task)) {
+                if (!sleep(self, task)) return;
+                if (!task) continue;
+            }
+
+            int delayMs = task();
+            if (delayMs == TASK_PARKED) {
+                continue;
+            } else if (delayMs < 0) {
+                endTask();
+            } else if (delayMs == 0) {
+                enqueue(std::move(task));
+            } else {
+                schedule(delayMs, std::move(task));
+            }
+        }
+    }
+
+};
+
+thread_local FlightWorkerPool *FlightWorkerPool::currentPool = nullptr;
+thread_local unsigned FlightWorkerPool::currentWorker = 0;
+
+// Copy of one active flight as the renderer sees it
+struct FlightView {
+    int id;
+    char flightName[30];
+    int8_t phase;
+    int8_t runway;
+    int8_t progress;     // ticks spent in the phase, 0-10
+    bool arrival;
+    int speed;
+    bool completed;
+    bool speedViolation;
+};
+
+struct RunwayView {
+    bool isAvailable;
+    char occupant[30];   // empty when free
+};
+
+// Immutable picture of the simulation, published as a whole once filled in
+struct SimSnapshot {
+    uint64_t version = 0;
+    int currentTime = 0;
+    long long simMs = 0;                                    // simulation time it shows
+    std::chrono::steady_clock::time_point publishedAt;      // wall time it was taken
+    vector<FlightView> flights;
+    vector<RunwayView> runways;
+};
+
+// Single-writer, single-reader triple buffer. The writer fills its back slot and
+// swaps it into the middle; the reader swaps the middle out for its front slot when
+// the dirty bit says it is newer. Neither side ever waits on the other.
+template <typename T>
+class TripleBuffer {
+public:
+    T &writeBuffer() { return slots[back]; }
+
+    void publish() {
+        back = middle.exchange(back | DIRTY, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Returns true if a newer value was picked up since the last call
+    bool update() {
+        if (!(middle.load(std::memory_order_acquire) & DIRTY)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T &readBuffer() const { return slots[front]; }
+
+private:
+    static constexpr int INDEX = 3;
+    static constexpr int DIRTY = 4;
+    T slots[3];
+    std::atomic<int> middle{1};
+    int back = 0;    // writer only
+    int front = 2;   // reader only
+};
+
+// Replays a journal into the calling thread's airport. load() rebuilds the
+// airport's runways and flights from the journal; index() then applies every event
+// once, keeping a checkpoint of the visible state every REPLAY_CHECKPOINT_MS, so a
+// seek restores the nearest checkpoint and applies at most that much of the journal.
+class JournalReplay {
+public:
+    static const long long REPLAY_CHECKPOINT_MS = 5000;
+
+    double speed = 1.0;          // journal ms per wall ms
+    long long startMs = 0;
+
+    bool load(const char* path) {
+        if (!journal.open(path)) {
+            cerr << "Could not read journal " << path << ": not a version " << JOURNAL_VERSION
+                 << " event journal" << endl;
+            return false;
+        }
+        const JournalHeader &header = journal.header();
+        airport->id = header.airportId;
+        snprintf(airport->code, sizeof(airport->code), "%.7s", header.code);
+        airport->seed = header.seed;
+        originWall = header.originWall;
+
+        vector<RunwaySpec> topology(header.runwayCount);
+        for (uint32_t i = 0; i < header.runwayCount; i++) {
+            snprintf(topology[i].name, sizeof(topology[i].name), "%.15s", journal.runways()[i].name);
+            topology[i].ops = journal.runways()[i].ops;
+        }
+        if (topology.empty() || !configureRunways(topology)) return false;
+
+        // In id order, so every flight gets back the id its events refer to
+        airport->flightTable.reserve(header.flightCount);
+        for (uint32_t i = 0; i < header.flightCount; i++) {
+            const JournalFlight &f = journal.flights()[i];
+            Aircraft flight;
+            snprintf(flight.flightName, sizeof(flight.flightName), "%.29s", f.flightName);
+            snprintf(flight.airline, sizeof(flight.airline), "%.29s", f.airline);
+            flight.type = f.type & 3;
+            flight.direction = f.direction & 3;
+            flight.airlinenumber = 0;
+            flight.scheduledTime = f.scheduledTime;
+            flight.priority = f.priority;
+            prepareFlight(flight, f.isEmergency);
+            if (flight.direction == DIR_NORTH || flight.direction == DIR_SOUTH)
+                airport->arrivalFlights.push_back(flight);
+            else
+                airport->departureFlights.push_back(flight);
+        }
+        return true;
+    }
+
+    // Once the flights are bound (the simulation is constructed): build the
+    // checkpoints, stopping at the first event that does not fit the journal
+    void index() {
+        const JournalEvent *events = journal.events();
+        size_t count = journal.eventCount();
+        checkpoints.clear();
+        long long nextCheckpoint = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!valid(events[i], i ? events[i - 1].timeMs : 0)) {
+                logger.log(LOG_WARN, "Journal ends at a bad record after %zu events", i);
+                count = i;
+                break;
+            }
+            position = i;
+            if (events[i].timeMs >= nextCheckpoint) {
+                saveCheckpoint(events[i].timeMs);
+                nextCheckpoint = (long long)events[i].timeMs + REPLAY_CHECKPOINT_MS;
+            }
+            apply(events[i]);
+        }
+        eventCount = count;
+        position = count;
+        lastMs = count ? events[count - 1].timeMs : 0;
+        if (checkpoints.empty()) saveCheckpoint(0);
+    }
+
+    // Restore the state at timeMs; AVNs passed over are not sent again
+    void seek(long long timeMs) {
+        timeMs = std::max(0LL, std::min(timeMs, lastMs));
+        size_t k = 0;
+        while (k + 1 < checkpoints.size() && checkpoints[k + 1].timeMs <= timeMs) k++;
+        restore(checkpoints[k]);
+        emitting = false;
+        advanceTo(timeMs);
+        emitting = true;
+        avnsSent = std::max(avnsSent, airport->aviationViolationNotices.size());
+    }
+
+    // Apply every event up to and including timeMs
+    void advanceTo(long long timeMs) {
+        const JournalEvent *events = journal.events();
+        while (position < eventCount && events[position].timeMs <= timeMs)
+            apply(events[position++]);
+        positionMs = timeMs;
+        airport->clock.virtualMs = timeMs;
+    }
+
+    // Safe from any thread; picked up by the replay loop
+    void requestSeek(long long timeMs) { seekRequest = std::max(0LL, timeMs); }
+    long long takeSeekRequest() { return seekRequest.exchange(-1); }
+
+    long long currentMs() const { return positionMs; }
+    long long endMs() const { return lastMs; }
+    size_t events() const { return eventCount; }
+    size_t eventsApplied() const { return position; }
+
+private:
+    struct FlightRow {
+        int id;
+        int speed;
+        int8_t phase;
+        int8_t runway;
+        int8_t progress;
+        uint8_t isAssigned;
+        uint8_t completed;
+        uint8_t hasSpeedViolation;
+    };
+
+    struct Checkpoint {
+        long long timeMs;
+        size_t position;
+        vector<FlightRow> active;
+        vector<int> runwayOccupant;
+        size_t avns;
+        int groundFaults;
+    };
+
+    JournalReader journal;
+    vector<Checkpoint> checkpoints;
+    size_t eventCount = 0;
+    size_t position = 0;                 // next event to apply
+    long long lastMs = 0;
+    std::atomic<long long> positionMs{0};
+    std::atomic<long long> seekRequest{-1};
+    time_t originWall = 0;
+    bool emitting = false;               // off while indexing and seeking
+    size_t avnsSent = 0;
+
+    bool valid(const JournalEvent &ev, uint32_t previousMs) const {
+        if (ev.timeMs < previousMs || ev.flight < 0 || ev.flight >= (int)airport->flightTable.size() ||
+            ev.type < JEV_ADMIT || ev.type > JEV_RELEASE)
+            return false;
+        if (ev.type == JEV_ASSIGN || ev.type == JEV_RELEASE)
+            return ev.arg >= 0 && ev.arg < airport->runwayCount;
+        if (ev.type == JEV_ADMIT || ev.type == JEV_SPEED || ev.type == JEV_PHASE)
+            return ev.arg >= 0 && ev.arg < MAX_PHASES;
+        return true;
+    }
+
+    // The same state changes the live run made, one event at a time
+    void apply(const JournalEvent &ev) {
+        FlightTable &table = airport->flightTable;
+        int id = ev.flight;
+        table.beginWrite(id);
+        switch (ev.type) {
+            case JEV_ADMIT:
+                table.phase[id] = ev.arg;
+                table.speed[id] = ev.a;
+                table.phaseData[id].timer = 0;
+                table.assignedRunway[id] = -1;
+                table.isAssigned[id] = 0;
+                table.completed[id] = 0;
+                table.hasSpeedViolation[id] = 0;
+                {
+                    std::lock_guard<std::mutex> lock(airport->activeMutex);
+                    airport->activeFlights.insert(table.record[id]);
+                }
+                break;
+            case JEV_ASSIGN:
+                airport->runways[ev.arg].currentFlight.store(id, std::memory_order_release);
+                table.assignedRunway[id] = ev.arg;
+                table.isAssigned[id] = 1;
+                table.record[id]->waitingTime = ev.a;
+                break;
+            case JEV_SPEED:
+            case JEV_PHASE:
+                table.phase[id] = ev.arg;
+                table.speed[id] = ev.a;
+                // Only the renderer reads the timer back, to place the flight within its phase
+                table.phaseData[id].timer = ev.type == JEV_PHASE ? 0 : std::min(table.phaseData[id].timer + 1, 10);
+                break;
+            case JEV_COMPLETE:
+                table.completed[id] = 1;
+                break;
+            case JEV_VIOLATION:
+                table.hasSpeedViolation[id] = 1;
+                break;
+            case JEV_AVN: {
+                std::lock_guard<std::mutex> lock(airport->avnMutex);
+                AVN avn;
+                fillAVN(avn, *table.record[id], ev.a, ev.b, (int)airport->aviationViolationNotices.size() + 1,
+                        originWall + (time_t)(ev.timeMs / 1000));
+                airport->aviationViolationNotices.push_back(avn);
+                if (emitting && airport->aviationViolationNotices.size() > avnsSent) {
+                    avnEmitter.push(&avn, sizeof(avn));
+                    avnsSent = airport->aviationViolationNotices.size();
+                }
+                break;
+            }
+            case JEV_GROUND_FAULT: {
+                airport->groundFaultCount++;
+                std::lock_guard<std::mutex> lock(airport->activeMutex);
+                airport->activeFlights.erase(id);
+                break;
+            }
+            case JEV_RELEASE: {
+                int expected = id;
+                airport->runways[ev.arg].currentFlight.compare_exchange_strong(expected, -1);
+                break;
+            }
+        }
+        table.endWrite(id);
+    }
+
+    void saveCheckpoint(long long timeMs) {
+        Checkpoint cp;
+        cp.timeMs = timeMs;
+        cp.position = position;
+        for (const Aircraft *flight : airport->activeFlights.items()) {
+            int id = flight->id;
+            const FlightTable &table = airport->flightTable;
+            cp.active.push_back({id, table.speed[id], table.phase[id], table.assignedRunway[id],
+                                 (int8_t)table.phaseData[id].timer, table.isAssigned[id], table.completed[id], table.hasSpeedViolation[id]});
+        }
+        for (int i = 0; i < airport->runwayCount; i++)
+            cp.runwayOccupant.push_back(airport->runways[i].occupant());
+        cp.avns = airport->aviationViolationNotices.size();
+        cp.groundFaults = airport->groundFaultCount;
+        checkpoints.push_back(std::move(cp));
+    }
+
+    // Only active flights are visible, so only their rows are put back; a flight
+    // admitted later gets its row reset by its JEV_ADMIT
+    void restore(const Checkpoint &cp) {
+        FlightTable &table = airport->flightTable;
+        {
+            std::lock_guard<std::mutex> lock(airport->activeMutex);
+            while (airport->activeFlights.size())
+                airport->activeFlights.erase(airport->activeFlights.items().back()->id);
+            for (const FlightRow &row : cp.active) {
+                table.beginWrite(row.id);
+                table.speed[row.id] = row.speed;
+                table.phase[row.id] = row.phase;
+                table.assignedRunway[row.id] = row.runway;
+                table.phaseData[row.id].timer = row.progress;
+                table.isAssigned[row.id] = row.isAssigned;
+                table.completed[row.id] = row.completed;
+                table.hasSpeedViolation[row.id] = row.hasSpeedViolation;
+                table.endWrite(row.id);
+                airport->activeFlights.insert(table.record[row.id]);
+            }
+        }
+        for (int i = 0; i < airport->runwayCount; i++)
+            airport->runways[i].currentFlight.store(cp.runwayOccupant[i], std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(airport->avnMutex);
+            airport->aviationViolationNotices.resize(cp.avns);
+        }
+        airport->groundFaultCount = cp.groundFaults;
+        position = cp.position;
+        positionMs = cp.timeMs;
+    }
+};
+
+// Admission and flight scheduling, independent of rendering. Runs either in real
+// time (flight ticks on the worker pool) or on the virtual clock (event engine).
+class ATCSimulation {
+public:
+    // Simulates the calling thread's airport
+    explicit ATCSimulation(bool virtualClock = false) : home(*airport) {
+        airport->clock.start(virtualClock);
+        airport->runwayArbiter->onGrant = [this](Aircraft *flight, RunwayArbiter::Clock::time_point releasedAt) {
+            wakeFlight(flight, releasedAt);
+        };
+
+        for (auto &f : airport->arrivalFlights) {
+            f.waitStartTime = airport->clock.now();
+            airport->flightTable.record[f.id] = &f;
+            scheduledFlights.push_back(&f);
+        }
+        for (auto &f : airport->departureFlights) {
+            f.waitStartTime = airport->clock.now();
+            airport->flightTable.record[f.id] = &f;
+            scheduledFlights.push_back(&f);
+        }
+        sort(scheduledFlights.begin(), scheduledFlights.end(), [](Aircraft* a, Aircraft* b) {
+            return a->scheduledTime < b->scheduledTime;
+        });
+
+        // Intern the names; the Aircraft records own the characters from here on
+        airport->flightIdByName.reserve(scheduledFlights.size());
+        for (Aircraft *f : scheduledFlights)
+            airport->flightIdByName.emplace(f->flightName, f->id);
+        airport->activeFlights.reserveIds(airport->flightTable.size());
+    }
+
+    // Runs until the last admission step; flights still in the air are left to finish()
+    void run(std::atomic<bool> &running) {
+        enterAirport(&home);
+        if (replay)
+            runReplay(running);
+        else if (airport->clock.isVirtual)
+            runVirtual(running);
+        else
+            runRealTime(running);
+    }
+
+    // Wait for every admitted flight to complete
+    void finish() {
+        if (flightPool) {
+            flightPool->waitAll();
+            flightPool->shutdown();
+        }
+    }
+
+    int getCurrentTime() const { return currentTime; }
+    size_t totalFlights() const { return scheduledFlights.size(); }
+    size_t admittedFlights() const { return scheduledIndex; }
+    long long eventsProcessed() const { return engine.processedCount(); }
+
+    vector<Aircraft*> getScheduledFlights() {
+        std::lock_guard<std::mutex> lock(scheduledMutex);
+        return scheduledFlights;
+    }
+
+    // Call before run() to have the simulation publish snapshots for a renderer
+    void enableSnapshots() { snapshotsEnabled = true; }
+
+    // One admission step outside run(); the benchmarks time it on its own
+    void step() { simulateStep(); }
+
+    // Call before run() to play a journal back instead of simulating
+    void replayFrom(JournalReplay *journalReplay) { replay = journalReplay; }
+    bool isReplay() const { return replay != nullptr; }
+
+    // Move a replay by deltaMs of journal time; ignored by a live simulation
+    void seekBy(long long deltaMs) {
+        if (replay) replay->requestSeek(replay->currentMs() + deltaMs);
+    }
+
+    // Latest published snapshot. Wait-free; must only be called from the one
+    // reader thread, and the reference stays valid until its next call.
+    const SimSnapshot &readSnapshot() {
+        snapshots.update();
+        return snapshots.readBuffer();
+    }
+
+private:
+    Airport &home;
+    std::atomic<int> currentTime{0};
+    size_t scheduledIndex = 0;
+    vector<Aircraft*> scheduledFlights;
+    vector<Aircraft*> flightsForThisMinute;
+    std::mutex scheduledMutex;
+    std::unique_ptr<FlightWorkerPool> flightPool;
+    EventEngine engine;
+    bool snapshotsEnabled = false;
+    uint64_t snapshotVersion = 0;
+    TripleBuffer<SimSnapshot> snapshots;
+    JournalReplay *replay = nullptr;
+
+    void runRealTime(std::atomic<bool> &running) {
+        // A pinned shard keeps all of its threads on its one core
+        if (home.core >= 0)
+            flightPool.reset(new FlightWorkerPool(1, [this]() { enterAirport(&home); }));
+        else
+            flightPool.reset(new FlightWorkerPool(std::max(2u, std::thread::hardware_concurrency()),
+                                                  [this]() { enterAirport(&home); }));
+        auto nextStep = std::chrono::steady_clock::now();
+        while (running) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= nextStep) {
+                simulateStep();
+
+                if (currentTime > SIM_END_TIME) {
+                    break;
+                }
+                nextStep += std::chrono::milliseconds(SIM_STEP_MS);
+            }
+
+            if (snapshotsEnabled) {
+                publishSnapshot();
+                std::this_thread::sleep_until(std::min(nextStep,
+                    std::chrono::steady_clock::now() + std::chrono::milliseconds(SNAPSHOT_PERIOD_MS)));
+            } else {
+                std::this_thread::sleep_until(nextStep);
+            }
+        }
+    }
+
+    // Copy one flight's row, retrying while its writer is mid-update
+    static FlightView readFlightView(const Aircraft *flight) {
+        int id = flight->id;
+        FlightView view;
+        view.id = id;
+        memcpy(view.flightName, flight->flightName, sizeof(view.flightName));
+        view.arrival = airport->flightTable.isArrival(id);
+
+        const std::atomic<uint32_t> &seq = airport->flightTable.seq[id].value;
+        uint32_t before, after;
+        do {
+            before = seq.load(std::memory_order_acquire);
+            view.phase = airport->flightTable.phase[id];
+            view.runway = airport->flightTable.assignedRunway[id];
+            view.progress = (int8_t)std::min(airport->flightTable.phaseData[id].timer, 10);
+            view.speed = airport->flightTable.speed[id];
+            view.completed = airport->flightTable.completed[id];
+            view.speedViolation = airport->flightTable.hasSpeedViolation[id];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return view;
+    }
+
+    // Fill the back buffer from live state and hand it to the renderer. Only the
+    // simulation thread takes activeMutex here; the renderer never locks anything.
+    void publishSnapshot() {
+        SimSnapshot &snap = snapshots.writeBuffer();
+        snap.version = ++snapshotVersion;
+        snap.currentTime = currentTime;
+        snap.simMs = airport->clock.elapsedMs();
+        snap.publishedAt = std::chrono::steady_clock::now();
+        snap.flights.clear();
+        {
+            std::lock_guard<std::mutex> lock(airport->activeMutex);
+            for (const Aircraft *flight : airport->activeFlights.items())
+                snap.flights.push_back(readFlightView(flight));
+        }
+        snap.runways.resize(airport->runwayCount);
+        for (int i = 0; i < airport->runwayCount; i++) {
+            RunwayView &view = snap.runways[i];
+            int occupant = airport->runways[i].occupant();
+            view.isAvailable = occupant < 0;
+            snprintf(view.occupant, sizeof(view.occupant), "%s",
+                     occupant >= 0 ? airport->flightTable.record[occupant]->flightName : "");
+        }
+        snapshots.publish();
+    }
+
+    // Same steps and ticks as the real-time run, but taken from a timestamped event
+    // queue with no sleeps; the loop ends once every flight has left the system
+    void runVirtual(std::atomic<bool> &running) {
+        engine.schedule(0, EV_SIM_STEP);
+        while (running && !engine.empty()) {
+            SimEvent ev = engine.pop();
+            Aircraft *flight = ev.flight;
+
+            switch (ev.type) {
+                case EV_SIM_STEP:
+                    simulateStep();
+                    if (snapshotsEnabled)
+                        publishSnapshot();
+                    if (currentTime <= SIM_END_TIME)
+                        engine.scheduleIn(SIM_STEP_MS, EV_SIM_STEP);
+                    break;
+
+                case EV_RUNWAY_REQUEST:
+                    // A queued flight gets its tick from wakeFlight() once granted
+                    if (airport->flightTable.isAssigned[flight->id] || airport->runwayArbiter->request(flight))
+                        engine.scheduleIn(0, EV_FLIGHT_TICK, flight);
+                    break;
+
+                case EV_FLIGHT_TICK:
+                    // An open episode is fined before the flight leaves, as in flightLifecycle()
+                    if (airport->flightTable.completed[flight->id] || !advanceFlight(flight)) {
+                        closeViolationEpisode(flight->id);
+                        engine.scheduleIn(0, EV_RUNWAY_RELEASE, flight);
+                    } else
+                        engine.scheduleIn(FLIGHT_TICK_MS, EV_FLIGHT_TICK, flight);
+                    break;
+
+                case EV_RUNWAY_RELEASE:
+                    freeRunway(flight->id);
+                    break;
+            }
+        }
+    }
+
+    // Journal time follows wall time times the replay speed; a seek rebases both.
+    // The dashboard is redrawn once per journal second, like the live run does.
+    void runReplay(std::atomic<bool> &running) {
+        replay->seek(replay->startMs);
+        logger.log(LOG_INFO, "Replaying %zu events, %.1f s of journal at %gx", replay->events(),
+                   replay->endMs() / 1000.0, replay->speed);
+        auto wallBase = std::chrono::steady_clock::now();
+        long long journalBase = replay->currentMs();
+        int shownTime = -1;
+        while (running) {
+            long long seekTo = replay->takeSeekRequest();
+            if (seekTo >= 0) {
+                replay->seek(seekTo);
+                wallBase = std::chrono::steady_clock::now();
+                journalBase = replay->currentMs();
+            }
+
+            double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallBase).count();
+            long long target = std::min(replay->endMs(), journalBase + (long long)(wallMs * replay->speed));
+            replay->advanceTo(target);
+            currentTime = (int)(target / 1000);
+            if (currentTime != shownTime) {
+                shownTime = currentTime;
+                std::lock_guard<std::mutex> lock(airport->displayMutex);
+                displayDashboard(currentTime);
+            }
+            if (snapshotsEnabled) publishSnapshot();
+            // A window stays open on the last frame, so it can still seek back
+            if (target >= replay->endMs() && !snapshotsEnabled) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(SNAPSHOT_PERIOD_MS));
+        }
+    }
+
+    // Hand an admitted flight to whichever executor drives this run
+    void dispatchFlight(Aircraft *flight) {
+        if (airport->clock.isVirtual) {
+            engine.scheduleIn(0, EV_RUNWAY_REQUEST, flight);
+            return;
+        }
+
+        // First lifecycle tick runs here, in priority order, so the runway goes to the
+        // highest priority flight of the minute; later ticks run on the worker pool
+        flightPool->beginTask();
+        int delayMs = flightLifecycle(flight);
+        if (delayMs == FlightWorkerPool::TASK_PARKED) {
+            return;  // queued at the arbiter, resumed by wakeFlight()
+        } else if (delayMs < 0) {
+            flightPool->endTask();
+        } else {
+            flightPool->resumeAfter(delayMs, [flight]() { return flightLifecycle(flight); });
+        }
+    }
+
+    // A parked flight was handed a runway: run its next tick right away
+    void wakeFlight(Aircraft *flight, RunwayArbiter::Clock::time_point releasedAt) {
+        if (airport->clock.isVirtual) {
+            airport->runwayArbiter->recordHandoff(flight, releasedAt);
+            engine.scheduleIn(0, EV_FLIGHT_TICK, flight);
+            return;
+        }
+
+        flightPool->resume([flight, releasedAt, first = true]() mutable {
+            if (first) {
+                airport->runwayArbiter->recordHandoff(flight, releasedAt);
+                first = false;
+            }
+            return flightLifecycle(flight);
+        });
+    }
+
+    void simulateStep() {
+        if (currentTime > SIM_END_TIME) 
+        {//simulationRunning = false;
+        return;}
+
+        std::vector<Aircraft*> flightsToProcess;
+        
+        {
+            std::lock_guard<std::mutex> lock(scheduledMutex);
+            flightsForThisMinute.clear();
+
+            while (scheduledIndex < scheduledFlights.size() &&
+                   scheduledFlights[scheduledIndex]->scheduledTime <= currentTime) {
+                flightsForThisMinute.push_back(scheduledFlights[scheduledIndex]);
+                scheduledIndex++;
+            }
+            
+        }
+        
+        logger.log(LOG_INFO, "Flights scheduled for this minute: %zu", flightsForThisMinute.size());
+            if (!flightsForThisMinute.empty()) {
+            // Sort the flights by priority - key change: sort by priority and type before processing
+            sort(flightsForThisMinute.begin(), flightsForThisMinute.end(), 
+                [](Aircraft* a, Aircraft* b) {
+                    // First by emergency status
+                    if (a->isEmergency && !b->isEmergency) return true;
+                    if (!a->isEmergency && b->isEmergency) return false;
+                    
+                  
+                  /*  
+                    // Then by type (MILITARY > MEDICAL > CARGO > COMMERCIAL)
+                    if (a->type != b->type) {
+                        if (a->type == MILITARY) return true;
+                        if (b->type == MILITARY) return false;
+                        if (a->type == MEDICAL) return true;
+                        if (b->type == MEDICAL) return false;
+                        if (a->type == CARGO) return true;
+                        if (b->type == CARGO) return false;
+                    }*/
+                      // Then by priority
+                    if (a->priority != b->priority)
+                        return a->priority > b->priority;
+                    // Finally by arrival time
+                    return a->entryTime < b->entryTime;
+                });
+            
+            logger.log(LOG_INFO, "Sorted flights by priority (from highest to lowest):");
+            for (auto flight : flightsForThisMinute) {
+                logger.log(LOG_INFO, "  - %s (Priority: %d, Type: %s)", flight->flightName,
+                           flight->priority, getAircraftTypeName(flight->type));
+            }
+            
+               // Create a copy to work with outside the lock
+            flightsToProcess = flightsForThisMinute;
+            
+            // Process flights in priority order
+            for (auto flight : flightsToProcess) {
+                // Add to active flights
+                {
+                    std::lock_guard<std::mutex> lock(airport->activeMutex);
+                    flight->phaseStartTime = airport->clock.now();
+                    airport->activeFlights.insert(flight);
+                }
+                airport->flightsAdmitted.add();
+                journalEvent(JEV_ADMIT, flight->id, airport->flightTable.phase[flight->id],
+                             airport->flightTable.speed[flight->id]);
+                
+                logger.log(LOG_INFO, "Flight %s is now active at time %d", flight->flightName, currentTime.load());
+
+                flight->entryTime = currentTime;
+                dispatchFlight(flight);
+            }
+        }
+        
+        // Display runway status
+        if (!cout.fail()) {
+            std::ostringstream out;
+            out << "\nCurrent Runway Status:\n";
+            for (int i = 0; i < airport->runwayCount; i++) {
+                int occupant = airport->runways[i].occupant();
+                out << "  Runway " << airport->runways[i].name << ": " 
+                    << (occupant < 0 ? "Available" : "Occupied by " + string(airport->flightTable.record[occupant]->flightName)) << "\n";
+            }
+            cout << out.str() << flush;
+        }
+        
+        // Display dashboard
+        {
+            std::lock_guard<std::mutex> lock(airport->displayMutex);
+            displayDashboard(currentTime);
+        }
+      
+  currentTime = (int)(airport->clock.elapsedMs() / 1000);
+
+    }
+};
+
+#ifndef ATC_HEADLESS
+// Quads of one label laid out at the origin in white, two triangles per glyph
+struct GlyphRun {
+    std::string text;
+    unsigned size = 0;
+    vector<sf::Vertex> vertices;
+};
+
+// Glyph metrics of printable ASCII per character size, fetched from the font once.
+// Labels are laid out from these tables, and only when their text changes; each
+// frame then just copies the quads into the batch of their character size.
+class GlyphCache {
+public:
+    explicit GlyphCache(const sf::Font &f) : font(f) {}
+
+    // The font page that the texture coordinates of a size refer to
+    const sf::Texture& texture(unsigned size) const { return font.getTexture(size); }
+
+    // Same placement as sf::Text: the baseline sits one character size down
+    void layout(GlyphRun &run, const std::string &text, unsigned size) {
+        const vector<sf::Glyph> &table = glyphs(size);
+        run.text = text;
+        run.size = size;
+        run.vertices.clear();
+        const float padding = 1.0f;
+        float x = 0;
+        sf::Uint32 previous = 0;
+        for (unsigned char c : text) {
+            x += font.getKerning(previous, c, size);
+            previous = c;
+            const sf::Glyph &glyph = (c >= 32 && c < 127) ? table[c - 32] : font.getGlyph(c, size, false);
+            if (c != ' ' && c != '\t') {
+                float left = x + glyph.bounds.left - padding;
+                float top = size + glyph.bounds.top - padding;
+                float right = x + glyph.bounds.left + glyph.bounds.width + padding;
+                float bottom = size + glyph.bounds.top + glyph.bounds.height + padding;
+                float u1 = glyph.textureRect.left - padding;
+                float v1 = glyph.textureRect.top - padding;
+                float u2 = glyph.textureRect.left + glyph.textureRect.width + padding;
+                float v2 = glyph.textureRect.top + glyph.textureRect.height + padding;
+                appendQuad(run.vertices, left, top, right, bottom, u1, v1, u2, v2);
+            }
+            x += glyph.advance;
+        }
+    }
+
+    static void appendQuad(vector<sf::Vertex> &out, float left, float top, float right, float bottom,
+                           float u1, float v1, float u2, float v2) {
+        sf::Vertex tl(sf::Vector2f(left, top), sf::Color::White, sf::Vector2f(u1, v1));
+        sf::Vertex tr(sf::Vector2f(right, top), sf::Color::White, sf::Vector2f(u2, v1));
+        sf::Vertex br(sf::Vector2f(right, bottom), sf::Color::White, sf::Vector2f(u2, v2));
+        sf::Vertex bl(sf::Vector2f(left, bottom), sf::Color::White, sf::Vector2f(u1, v2));
+        out.insert(out.end(), {tl, tr, br, tl, br, bl});
+    }
+
+private:
+    const sf::Font &font;
+    std::map<unsigned, vector<sf::Glyph>> tables;
+
+    const vector<sf::Glyph>& glyphs(unsigned size) {
+        vector<sf::Glyph> &table = tables[size];
+        if (table.empty()) {
+            for (sf::Uint32 c = 32; c < 127; c++) table.push_back(font.getGlyph(c, size, false));
+        }
+        return table;
+    }
+};
 
+class Visualizer {
+private:
+    // Declared first so it is unmapped last: the font and music read from it
+    AssetBundle bundle;
+    std::string assetDir;                 // the binary's directory
+    sf::RenderWindow window;
+    sf::Font font;
+    sf::Clock simClock;
+    ATCSimulation &sim;
+    std::atomic<bool> simulationRunning{true};
+    sf::Texture airportTexture;
+    sf::Sprite airportSprite;
+    sf::Texture runwayTexture;
+    sf::Vector2f runwayScale;
+    sf::Vector2f flightScale{0.5f, 0.5f};
 
-          if (!runwayTexture.loadFromFile("/home/huma-taj/Downloads/runway.png")) {
-              std::cerr << "Failed to load runway texture.\n";
-          }
-          runwaySpriteTemplate.setTexture(runwayTexture);
-          sf::Vector2u runwaySize = runwayTexture.getSize();
-         float runwayScaleX = static_cast<float>(windowSize.x) / runwaySize.x;
-          float runwayScaleY = 1.5f;  // Keep or adjust based on height needs
-          runwaySpriteTemplate.setScale(runwayScaleX, runwayScaleY);
+    // Each frame is a handful of draw calls whatever the traffic: runways against the
+    // runway texture, aircraft, panels and legend dots against the atlas (plane icon
+    // plus a white block for solid fills), and one batch per character size of text
+    sf::Texture atlasTexture;
+    sf::Vector2f planeSize;               // plane icon at the atlas origin
+    sf::Vector2f whiteTexel;              // centre of the white block
+    sf::VertexArray runwayBatch{sf::Triangles};
+    sf::VertexArray geometryBatch{sf::Triangles};
+    std::map<unsigned, sf::VertexArray> textBatches;   // by character size
+    GlyphCache glyphs{font};
+    GlyphRun scheduledTitle, legendTitle, legendLabels[3], timeLabel;
+    vector<GlyphRun> runwayLabels, occupantLabels;
 
+    // Images are decoded off the render thread and uploaded by the first frame after;
+    // until then runways and aircraft are drawn as plain shapes and the background is
+    // left out. Only the decoder writes an image until its state leaves DECODE_PENDING.
+    enum { ASSET_BACKGROUND, ASSET_RUNWAY, ASSET_PLANE, IMAGE_ASSETS };
+    enum { DECODE_PENDING, DECODE_READY, DECODE_FAILED };
+    sf::Image decoded[IMAGE_ASSETS];
+    std::atomic<int> decodeState[IMAGE_ASSETS] = {};
+    bool assetReady[IMAGE_ASSETS] = {};
+    bool assetSettled[IMAGE_ASSETS] = {};
+    std::thread decoder;
+    sf::FloatRect planeTex;               // plane icon in the atlas, the white block until decoded
 
-          if (!flightTexture.loadFromFile("/home/huma-taj/Downloads/plane_icon.png")) {
-              std::cerr << "Failed to load aircraft texture.\n";
-          }
-          flightSpriteTemplate.setTexture(flightTexture);
-          flightSpriteTemplate.setScale(0.5f, 0.5f);  // Adjust for aircraft size
+public:
+    explicit Visualizer(ATCSimulation &simulation)
+        : window(sf::VideoMode(1400, 1000), "ATC Simulation"), sim(simulation) {
+        window.setFramerateLimit(60);
+        sim.enableSnapshots();
+        assetDir = executableDir();
+        if (!bundle.open(assetDir + ASSET_BUNDLE_FILE))
+            std::cerr << "No asset bundle at " << assetDir << ASSET_BUNDLE_FILE
+                      << "; loading loose files (pack them with --pack-assets)\n";
+        if (!loadAsset(font, "Howdy Frog.ttf")) {
+            std::cerr << "Failed to load font.\n";
+        }
+        airportSprite.setColor(sf::Color(255, 255, 255, 80));  // Still dim
+        buildAtlas(nullptr);
+        decoder = std::thread([this]() { decodeImages(); });
+    }
 
+    ~Visualizer() {
+        if (decoder.joinable()) decoder.join();
     }
 
 void runSFML() {
     cout << "========== STARTING SIMULATION ==========\n";
-    cout << "Total flights to process: " << scheduledFlights.size() << endl;
+    cout << "Total flights to process: " << sim.totalFlights() << endl;
 
     std::atomic<bool> simulationFinished = false;  // new shared flag
       // Load and play background music
+    // Streamed from the bundle's mapping, which outlives the loop
     sf::Music bgMusic;
-    if (!bgMusic.openFromFile("/home/huma-taj/Downloads/bg_music.ogg")) {
+    const void *musicBytes;
+    size_t musicSize;
+    bool musicOpen = bundle.find("bg_music.ogg", musicBytes, musicSize)
+                         ? bgMusic.openFromMemory(musicBytes, musicSize)
+                         : bgMusic.openFromFile(assetDir + "bg_music.ogg");
+    if (!musicOpen) {
         std::cerr << "Failed to load background music!" << std::endl;
     } else {
         bgMusic.setLoop(true);
@@ -267,16 +2367,8 @@ void runSFML() {
     }
     // Create simulation thread
     std::thread simThread([this, &simulationFinished]() {
-        while (simulationRunning) {
-            simulateStep();
-
-            if (currentTime > 300) {  // Or your end condition
-                simulationRunning = false;
-                break;
-            }
-
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-        }
+        sim.run(simulationRunning);
+        simulationRunning = false;
         simulationFinished = true;
     });
 
@@ -290,10 +2382,17 @@ void runSFML() {
         sf::Event event;
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed || !simulationRunning) {
+                // EXIT goes out from main() after avnEmitter.stop(), behind the backlog
                 simulationRunning = false;
-                   sendExitSignal();
                 window.close();
             }
+            // Replay: arrow keys seek 30 s back or forward
+            if (event.type == sf::Event::KeyPressed && sim.isReplay()) {
+                if (event.key.code == sf::Keyboard::Left) sim.seekBy(-REPLAY_SEEK_STEP_MS);
+                if (event.key.code == sf::Keyboard::Right) sim.seekBy(REPLAY_SEEK_STEP_MS);
+            }
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3)
+                showFrameStats = !showFrameStats;
         }
 
         render();
@@ -302,9 +2401,7 @@ void runSFML() {
     // Clean up
     simThread.join();
 
-    for (auto& t : flightThreads) {
-        t.join();
-    }
+    sim.finish();
 
     return;
 }
@@ -312,25 +2409,145 @@ void runSFML() {
 // Add these new members to your Visualizer class
 private:
    
+    // Loaded from the bundle, or from the binary's directory if the bundle lacks it
+    template <typename Asset>
+    bool loadAsset(Asset &asset, const char* name) {
+        const void *bytes;
+        size_t size;
+        if (bundle.find(name, bytes, size)) return asset.loadFromMemory(bytes, size);
+        return asset.loadFromFile(assetDir + name);
+    }
+
+    // Decoder thread: JPEG/PNG decoding is the slow part of loading, so the window
+    // and the simulation start without waiting for it
+    void decodeImages() {
+        static const char* names[IMAGE_ASSETS] = {"airport_bg.jpeg", "runway.png", "plane_icon.png"};
+        static const char* failures[IMAGE_ASSETS] = {"Failed to load airport background.\n",
+                                                     "Failed to load runway texture.\n",
+                                                     "Failed to load aircraft texture.\n"};
+        for (int i = 0; i < IMAGE_ASSETS; i++) {
+            bool ok = loadAsset(decoded[i], names[i]);
+            if (!ok) std::cerr << failures[i];
+            decodeState[i].store(ok ? DECODE_READY : DECODE_FAILED, std::memory_order_release);
+        }
+    }
+
+    // Render thread: turn each decoded image into its texture once
+    void uploadDecoded() {
+        for (int i = 0; i < IMAGE_ASSETS; i++) {
+            if (assetSettled[i]) continue;
+            int state = decodeState[i].load(std::memory_order_acquire);
+            if (state == DECODE_PENDING) continue;
+            assetSettled[i] = true;
+            if (state == DECODE_FAILED) continue;
+            sf::Vector2u windowSize = window.getSize();
+            if (i == ASSET_BACKGROUND && airportTexture.loadFromImage(decoded[i])) {
+                airportSprite.setTexture(airportTexture, true);
+                sf::Vector2u textureSize = airportTexture.getSize();
+                airportSprite.setScale(static_cast<float>(windowSize.x) / textureSize.x,
+                                       static_cast<float>(windowSize.y) / textureSize.y);
+                assetReady[i] = true;
+            } else if (i == ASSET_RUNWAY && runwayTexture.loadFromImage(decoded[i])) {
+                sf::Vector2u runwaySize = runwayTexture.getSize();
+                float runwayScaleX = runwaySize.x ? static_cast<float>(windowSize.x) / runwaySize.x : 1.0f;
+                float runwayScaleY = 1.5f;  // Keep or adjust based on height needs
+                runwayScale = sf::Vector2f(runwayScaleX, runwayScaleY);
+                assetReady[i] = true;
+            } else if (i == ASSET_PLANE) {
+                buildAtlas(&decoded[i]);
+                assetReady[i] = true;
+            }
+            decoded[i] = sf::Image();
+        }
+    }
+
+    // Plane icon at the origin, a 4x4 white block to its right. Until the icon is
+    // decoded the atlas is the white block alone and aircraft are plain boxes.
+    void buildAtlas(const sf::Image *plane) {
+        sf::Vector2u size = plane ? plane->getSize() : sf::Vector2u(0, 0);
+        sf::Image atlas;
+        atlas.create(size.x + 4, std::max(size.y, 4u), sf::Color::Transparent);
+        if (plane) atlas.copy(*plane, 0, 0);
+        for (unsigned x = 0; x < 4; x++)
+            for (unsigned y = 0; y < 4; y++)
+                atlas.setPixel(size.x + x, y, sf::Color::White);
+        if (!atlasTexture.loadFromImage(atlas)) {
+            std::cerr << "Failed to build the aircraft atlas.\n";
+        }
+        whiteTexel = sf::Vector2f(size.x + 2.0f, 2.0f);
+        if (plane) {
+            planeSize = sf::Vector2f(size.x, size.y);
+            planeTex = sf::FloatRect(0, 0, size.x, size.y);
+        } else {
+            planeSize = sf::Vector2f(60, 40);
+            planeTex = sf::FloatRect(whiteTexel.x, whiteTexel.y, 0, 0);
+        }
+    }
+
+    // Horizontal position of a flight at a simulation time
+    struct TrackSample {
+        double simMs;
+        float x;
+    };
+
     // Structure to track visual state of aircraft
     struct AircraftVisualState {
         std::chrono::steady_clock::time_point lastStateChange;
-        int currentPhase;
-        int runwayIndex;
-        float targetX;
-        float currentX;
-        bool isActive;
-        bool pendingRemoval;
+        int currentPhase = -1;
+        int runwayIndex = -1;
+        // Drawn between from and to by simulation time; to is the newest position
+        TrackSample from{0, 0}, to{0, 0};
+        float currentX = 0;                  // as last drawn
+        float removalX = 0;                  // where it was when it left the snapshot
+        bool isActive = false;
+        bool pendingRemoval = false;
         // Additional visual state properties
         float speed;
         bool completed;
         bool speedViolation;
         bool avionicsActive;
+        // Label geometry, laid out again only when the text changes
+        GlyphRun nameLabel, phaseLabel, speedLabel, avionicsLabel, runwayLabel;
     };
      // For smooth visualization
     std::unordered_map<std::string, float> flightFadeMap;  // Alpha values for fading
     std::unordered_map<std::string, AircraftVisualState> flightVisualStates;
+    uint64_t seenSnapshotVersion = ~0ULL;
 
+    // Simulation time on screen: the newest snapshot's time advanced by the wall time
+    // since it was taken at the simulation's measured speed, RENDER_DELAY_MS behind.
+    // Frames follow the display's refresh whatever the simulation's load or speed.
+    double simRate = -1;                  // simulation ms per wall ms, -1 until measured
+    long long lastSnapshotMs = 0;
+    std::chrono::steady_clock::time_point lastSnapshotAt;
+    double displayMs = 0;
+
+    // Frame-time overlay, toggled with F3
+    struct FrameStats {
+        float intervalMs[FRAME_STATS_WINDOW] = {};
+        float cpuMs[FRAME_STATS_WINDOW] = {};
+        int count = 0;
+        int next = 0;
+
+        void add(float interval, float cpu) {
+            intervalMs[next] = interval;
+            cpuMs[next] = cpu;
+            next = (next + 1) % FRAME_STATS_WINDOW;
+            count = std::min(count + 1, FRAME_STATS_WINDOW);
+        }
+    };
+    FrameStats frameStats;
+    bool showFrameStats = true;
+    std::chrono::steady_clock::time_point lastFrameAt, statsShownAt;
+    std::string statsText[3];
+    GlyphRun statsLabels[3];
+
+
+    // Vertical distance between runways: the classic 200px, squeezed to fit large fields
+    float runwaySpacing(size_t count) {
+        if (count == 0) return 200.0f;
+        return std::min(200.0f, (window.getSize().y - 350.0f) / count);
+    }
 
     // Helper function to get color based on flight phase
     sf::Color getColorForPhase(int phase) {
@@ -347,87 +2564,133 @@ private:
         }
     }
 
+    // Thread CPU time in milliseconds
+    static double threadCpuMs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+    }
+
+    // Position a phase places a flight at when it begins
+    static float phaseX(int phase) {
+        switch (phase) {
+            case APPROACH: return 200.0f;
+            case LANDING: return 400.0f;
+            case TAXI: return 600.0f;
+            case HOLDING: return 400.0f;
+            case TAKEOFF_ROLL: return 800.0f;
+            case DEPARTURE: return 1000.0f;
+            case AT_GATE: return 300.0f;
+            case CLIMB: return 900.0f;
+            default: return 500.0f;
+        }
+    }
+
+    // A flight moves from its phase's position toward the next phase's as the
+    // phase's ten ticks run out; a departure leaves the screen on the right
+    static float trackX(const FlightView &flight) {
+        int next;
+        if (flight.arrival) {
+            switch (flight.phase) {
+                case HOLDING: next = APPROACH; break;
+                case APPROACH: next = LANDING; break;
+                case LANDING: next = TAXI; break;
+                case TAXI: next = AT_GATE; break;
+                default: next = flight.phase;
+            }
+        } else {
+            switch (flight.phase) {
+                case AT_GATE: next = TAXI; break;
+                case TAXI: next = TAKEOFF_ROLL; break;
+                case TAKEOFF_ROLL: next = CLIMB; break;
+                case CLIMB: next = DEPARTURE; break;
+                case DEPARTURE: return 1000.0f + flight.progress * 20.0f;
+                default: next = flight.phase;
+            }
+        }
+        float from = phaseX(flight.phase);
+        return from + flight.progress / 10.0f * (phaseX(next) - from);
+    }
+
+    // Interpolated between the two samples, or carried on past the newest one for up
+    // to RENDER_EXTRAPOLATE_MS, then held
+    static float positionAt(const AircraftVisualState &state, double simMs) {
+        double span = state.to.simMs - state.from.simMs;
+        if (span <= 0) return state.to.x;
+        double u = std::max(0.0, std::min((simMs - state.from.simMs) / span, 1.0 + RENDER_EXTRAPOLATE_MS / span));
+        return state.from.x + (float)u * (state.to.x - state.from.x);
+    }
+
+    // Advance the on-screen simulation time; a new snapshot also updates the measured
+    // simulation speed, and a seek (time going back or leaping ahead) resets it
+    void advanceDisplayTime(const SimSnapshot &snap, std::chrono::steady_clock::time_point now, bool fresh) {
+        if (fresh) {
+            long long delta = snap.simMs - lastSnapshotMs;
+            double wallMs = std::chrono::duration<double, std::milli>(snap.publishedAt - lastSnapshotAt).count();
+            bool seeked = simRate >= 0 && (delta < 0 || delta > REPLAY_SEEK_STEP_MS / 2);
+            if (seeked) {
+                simRate = -1;
+                displayMs = snap.simMs - RENDER_DELAY_MS;
+                for (auto &pair : flightVisualStates)
+                    pair.second.from = pair.second.to = {displayMs, pair.second.currentX};
+            } else if (lastSnapshotAt.time_since_epoch().count() && wallMs > 0) {
+                double rate = delta / wallMs;
+                simRate = simRate < 0 ? rate : simRate + 0.2 * (rate - simRate);
+            }
+            lastSnapshotMs = snap.simMs;
+            lastSnapshotAt = snap.publishedAt;
+        }
+        double sinceSnapshot = std::chrono::duration<double, std::milli>(now - snap.publishedAt).count();
+        double target = snap.simMs + sinceSnapshot * std::max(simRate, 0.0) - RENDER_DELAY_MS;
+        // Rate jitter never runs the picture backwards
+        displayMs = std::max(displayMs, target);
+    }
+
     // Function to update visual state based on backend state
-    void updateVisualStates() {
+    void updateVisualStates(const SimSnapshot &snap) {
         auto now = std::chrono::steady_clock::now();
-        
-        // Get local copies of backend state under locks
-        std::array<Runway, 3> localRunways;
-        {
-            std::lock_guard<std::mutex> lock(runwayMutex);
-            for (int i = 0; i < 3; ++i)
-                localRunways[i] = runways[i];
-        }
-        
-        std::vector<Aircraft*> localActive;
-        {
-            std::lock_guard<std::mutex> lock(activeMutex);
-          localActive = activeFlights;
-    
+        // The simulation publishes a few times a second; frames in between only
+        // advance the clock and age out departed flights
+        bool fresh = snap.version != seenSnapshotVersion;
+        advanceDisplayTime(snap, now, fresh);
+        if (!fresh) {
+            removeDeparted(now);
+            return;
         }
+        seenSnapshotVersion = snap.version;
         
         // Update all active flights
         std::unordered_set<std::string> currentActiveFlights;
-        for (Aircraft* flight : localActive) {
-            if (!flight) continue;
-            
-            currentActiveFlights.insert(flight->flightName);
+        for (const FlightView &flight : snap.flights) {
+            currentActiveFlights.insert(flight.flightName);
             
             // Create or update visual state
-            auto& state = flightVisualStates[flight->flightName];
-            
-            // Check if phase changed
-            bool stateChanged = (state.currentPhase != flight->phase || 
-                                state.runwayIndex != flight->assignedRunway || 
-                                !state.isActive);
+            auto& state = flightVisualStates[flight.flightName];
             
             // Always update properties even if phase didn't change
-            state.speed = flight->speed;
-            state.completed = flight->completed;
-            state.speedViolation = flight->hasSpeedViolation;
-            state.avionicsActive = flight->hasSpeedViolation;
-            
-            if (stateChanged) {
-                state.lastStateChange = now;
-                state.currentPhase = flight->phase;
-                state.runwayIndex = flight->assignedRunway;
+            state.speed = flight.speed;
+            state.completed = flight.completed;
+            state.speedViolation = flight.speedViolation;
+            state.avionicsActive = flight.speedViolation;
+            state.currentPhase = flight.phase;
+            state.runwayIndex = flight.runway;
+
+            // A new position is reached by the time the picture catches up with the
+            // snapshot; a new flight slides in from the left edge
+            float x = trackX(flight);
+            if (!state.isActive) {
                 state.isActive = true;
-                state.pendingRemoval = false;
-                
-                // Set target position based on phase - DO NOT MODIFY FLIGHT PROPERTIES
-                switch (flight->phase) {
-                    case APPROACH:
-                        state.targetX = 200.0f;
-                        break;
-                    case LANDING:
-                        state.targetX = 400.0f;
-                        break;
-                    case TAXI:
-                        state.targetX = 600.0f;
-                        break;
-                    case HOLDING:
-                        state.targetX = 400.0f;
-                        break;
-                    case TAKEOFF_ROLL:
-                        state.targetX = 800.0f;
-                        break;
-                    case DEPARTURE:
-                        state.targetX = 1000.0f;
-                        break;
-                    case AT_GATE:
-                        state.targetX = 300.0f;
-                        break;
-                    case CLIMB:
-                        state.targetX = 900.0f;
-                        break;
-                    default:
-                        state.targetX = 500.0f;
-                }
+                state.lastStateChange = now;
+                state.from = {displayMs, 0.0f};
+                state.to = {(double)snap.simMs, x};
+            } else if (x != state.to.x) {
+                state.from = {displayMs, state.currentX};
+                state.to = {(double)std::max<long long>(snap.simMs, (long long)displayMs), x};
             }
             
             // Ensure fade-in effect for new flights
-            if (flightFadeMap.find(flight->flightName) == flightFadeMap.end())
-                flightFadeMap[flight->flightName] = 0.0f;
+            if (flightFadeMap.find(flight.flightName) == flightFadeMap.end())
+                flightFadeMap[flight.flightName] = 0.0f;
         }
         
         // Mark flights for removal that are no longer active
@@ -436,11 +2699,14 @@ private:
                 !pair.second.pendingRemoval) {
                 pair.second.pendingRemoval = true;
                 pair.second.lastStateChange = now;
-                pair.second.targetX = 1200.0f;  // Move off screen to the right
+                pair.second.removalX = pair.second.currentX;
             }
         }
-        
-        // Remove flights that have been pending removal for more than 3 seconds
+        removeDeparted(now);
+    }
+
+    // Remove flights that have been pending removal for more than 3 seconds
+    void removeDeparted(std::chrono::steady_clock::time_point now) {
         std::vector<std::string> toRemove;
         for (auto& pair : flightVisualStates) {
             if (pair.second.pendingRemoval) {
@@ -458,93 +2724,99 @@ private:
         }
     }
 
+    // Two triangles into a batch; tex is the texture rectangle in pixels
+    static void appendQuad(sf::VertexArray &batch, float x, float y, float w, float h,
+                           const sf::Color &color, const sf::FloatRect &tex) {
+        sf::Vertex tl(sf::Vector2f(x, y), color, sf::Vector2f(tex.left, tex.top));
+        sf::Vertex tr(sf::Vector2f(x + w, y), color, sf::Vector2f(tex.left + tex.width, tex.top));
+        sf::Vertex br(sf::Vector2f(x + w, y + h), color, sf::Vector2f(tex.left + tex.width, tex.top + tex.height));
+        sf::Vertex bl(sf::Vector2f(x, y + h), color, sf::Vector2f(tex.left, tex.top + tex.height));
+        batch.append(tl); batch.append(tr); batch.append(br);
+        batch.append(tl); batch.append(br); batch.append(bl);
+    }
+
+    void appendSolid(float x, float y, float w, float h, const sf::Color &color) {
+        appendQuad(geometryBatch, x, y, w, h, color, sf::FloatRect(whiteTexel.x, whiteTexel.y, 0, 0));
+    }
+
+    // Filled circle with its bounding box at (x, y), like sf::CircleShape
+    void appendCircle(float x, float y, float radius, const sf::Color &color) {
+        const int segments = 24;
+        sf::Vector2f centre(x + radius, y + radius);
+        for (int i = 0; i < segments; i++) {
+            float a0 = 2 * 3.14159265f * i / segments, a1 = 2 * 3.14159265f * (i + 1) / segments;
+            geometryBatch.append(sf::Vertex(centre, color, whiteTexel));
+            geometryBatch.append(sf::Vertex(sf::Vector2f(centre.x + radius * std::cos(a0), centre.y + radius * std::sin(a0)), color, whiteTexel));
+            geometryBatch.append(sf::Vertex(sf::Vector2f(centre.x + radius * std::cos(a1), centre.y + radius * std::sin(a1)), color, whiteTexel));
+        }
+    }
+
+    // Queue a label at (x, y); its glyph quads are only laid out again if text changed
+    void appendLabel(GlyphRun &run, const std::string &text, unsigned size, float x, float y, const sf::Color &color) {
+        if (run.size != size || run.text != text) glyphs.layout(run, text, size);
+        sf::VertexArray &batch = textBatches[size];
+        if (batch.getPrimitiveType() != sf::Triangles) batch.setPrimitiveType(sf::Triangles);
+        for (const sf::Vertex &v : run.vertices)
+            batch.append(sf::Vertex(sf::Vector2f(v.position.x + x, v.position.y + y), color, v.texCoords));
+    }
+
+    static const char* phaseName(int phase) {
+        switch (phase) {
+            case APPROACH: return "Approaching";
+            case LANDING: return "Landing";
+            case TAXI: return "Taxiing";
+            case HOLDING: return "holding";
+            case TAKEOFF_ROLL: return "Takeoff";
+            case DEPARTURE: return "Departing";
+            case AT_GATE: return "At Gate";
+            case CLIMB: return "Climbing";
+            default: return "Unknown";
+        }
+    }
+
 public:
     void render() {
-        // Update visual states based on backend data
-        updateVisualStates();
-        
-        window.clear();
-        window.draw(airportSprite);  // Background
-        
-        // 1. Lock local copies
-        std::array<Runway, 3> localRunways;
-        {
-            std::lock_guard<std::mutex> lock(runwayMutex);
-            for (int i = 0; i < 3; ++i)
-                localRunways[i] = runways[i];
-        }
+        auto frameStart = std::chrono::steady_clock::now();
+        double cpuStart = threadCpuMs();
+
+        // Update visual states from the latest published snapshot (no locks taken)
+        const SimSnapshot &snap = sim.readSnapshot();
+        updateVisualStates(snap);
+        uploadDecoded();
+
+        runwayBatch.clear();
+        geometryBatch.clear();
+        for (auto &batch : textBatches) batch.second.clear();
         
-        std::vector<Aircraft*> localScheduled;
-        {
-            std::lock_guard<std::mutex> lock(scheduledMutex);
-            localScheduled = scheduledFlights;
-        }
+        const vector<RunwayView> &localRunways = snap.runways;
+        float spacing = runwaySpacing(localRunways.size());
         
-        // 2. Draw Runways with color based on availability
-        for (int i = 0; i < 3; i++) {
-            sf::Sprite runwaySprite = runwaySpriteTemplate;
-            runwaySprite.setPosition(5, 250 + i * 200);
-            runwaySprite.setColor(localRunways[i].isAvailable
-                ? sf::Color(200, 255, 200)  // greenish
-                : sf::Color(255, 120, 120)  // reddish
-            );
-            window.draw(runwaySprite);
-            
-            // Draw runway label
-            sf::Text label("Runway ", font, 16);
-            label.setString("Runway " + std::string(1, 'A' + i));
-            label.setPosition(runwaySprite.getPosition().x, 
-                             runwaySprite.getPosition().y - 20);
-            label.setFillColor(sf::Color::White);
-            window.draw(label);
+        // 2. Runways with color based on availability
+        sf::Vector2u runwaySize = runwayTexture.getSize();
+        sf::FloatRect runwayRect(0, 0, runwaySize.x, runwaySize.y);
+        runwayLabels.resize(localRunways.size());
+        occupantLabels.resize(localRunways.size());
+        for (size_t i = 0; i < localRunways.size(); i++) {
+            float x = 5, y = 250 + i * spacing;
+            sf::Color color = localRunways[i].isAvailable
+                                  ? sf::Color(200, 255, 200)   // greenish
+                                  : sf::Color(255, 120, 120);  // reddish
+            if (assetReady[ASSET_RUNWAY])
+                appendQuad(runwayBatch, x, y, runwaySize.x * runwayScale.x, runwaySize.y * runwayScale.y,
+                           color, runwayRect);
+            else
+                appendSolid(x, y, window.getSize().x - 10.0f, 60, sf::Color(color.r / 2, color.g / 2, color.b / 2));
+            appendLabel(runwayLabels[i], "Runway " + std::string(runwayName(i)), 16, x, y - 20, sf::Color::White);
             
             // If runway is occupied, show aircraft name
-            if (!localRunways[i].isAvailable && strlen(localRunways[i].currentFlight) > 0) {
-                sf::Text occupiedLabel(localRunways[i].currentFlight, font, 14);
-                occupiedLabel.setPosition(runwaySprite.getPosition().x + 100, 
-                                         runwaySprite.getPosition().y - 20);
-                occupiedLabel.setFillColor(sf::Color::Yellow);
-                window.draw(occupiedLabel);
-            }
+            if (!localRunways[i].isAvailable && localRunways[i].occupant[0])
+                appendLabel(occupantLabels[i], localRunways[i].occupant, 14, x + 100, y - 20, sf::Color::Yellow);
         }
         
-        // 3. Draw Scheduled Flights (left side list)
-        {
-           int y = 100;
-           /* for (Aircraft* flight : localScheduled) {
-                if (!flight) continue;
-                
-                // Skip if this flight is already active
-                if (flightVisualStates.find(flight->flightName) != flightVisualStates.end() &&
-                    flightVisualStates[flight->flightName].isActive)
-                    continue;
-                
-                sf::CircleShape aircraft(10);
-                aircraft.setFillColor(sf::Color(255, 255, 255, 200));
-                aircraft.setPosition(50, y);
-                window.draw(aircraft);
-                
-                sf::Text label(flight->flightName, font, 12);
-                label.setPosition(70, y - 5);
-                label.setFillColor(sf::Color::White);
-                window.draw(label);
-                
-                // Add scheduled time
-                sf::Text timeLabel("T+" + std::to_string(flight->scheduledTime), font, 12);
-                timeLabel.setPosition(170, y - 5);
-                timeLabel.setFillColor(sf::Color(200, 200, 200));
-                window.draw(timeLabel);
-                
-                y += 30;
-            }*/
-            
-            sf::Text label("Scheduled Flights", font, 14);
-            label.setPosition(30, 50);
-            label.setFillColor(sf::Color::White);
-            window.draw(label);
-        }
+        // 3. Scheduled Flights (left side list)
+        appendLabel(scheduledTitle, "Scheduled Flights", 14, 30, 50, sf::Color::White);
         
-        // 4. Draw Active and Pending Removal Flights (On Runways)
+        // 4. Active and Pending Removal Flights (On Runways)
         auto now = std::chrono::steady_clock::now();
         int waitingX=0;
         for (auto& pair : flightVisualStates) {
@@ -564,299 +2836,780 @@ public:
                 alpha = std::min(255.0f, alpha + 5.0f);
             }
             
-            // Smooth position animation (with easing)
-            float t = std::min(1.0f, elapsed * 2.0f);  // Faster animation
-            t = 1.0f - std::pow(1.0f - t, 3.0f);  // Cubic ease out
-            
-            float startX = (state.currentX == 0) ? 0.0f : state.currentX;
-            state.currentX = startX + t * (state.targetX - startX);
-            if(state.runwayIndex != 0 && state.runwayIndex != 1 && state.runwayIndex !=2  )
+            if (state.pendingRemoval) {
+                // Slide off screen to the right (cubic ease out)
+                float t = std::min(1.0f, elapsed * 2.0f);
+                t = 1.0f - std::pow(1.0f - t, 3.0f);
+                state.currentX = state.removalX + t * (1200.0f - state.removalX);
+            } else {
+                state.currentX = positionAt(state, displayMs);
+            }
+            if (state.runwayIndex < 0 || state.runwayIndex >= (int)localRunways.size())
             {
                      state.currentX= 300 + waitingX;
                      waitingX += 100;
+                     // Once assigned it slides from its place in the queue
+                     state.from = state.to = {displayMs, state.currentX};
             }
             
-            // Determine Y from assigned runway
-            float y = 220 + state.runwayIndex * 200;
-            
-            // Set color based on phase with alpha
-            sf::Color color = getColorForPhase(state.currentPhase);
-            
-            // Override color for speed violation
-            if (state.speedViolation) {
-                color = sf::Color(255, 50, 50); // Bright red for violation
-            }
-            
-            color.a = static_cast<sf::Uint8>(alpha);
-            
-            // Draw sprite
-            sf::Sprite sprite = flightSpriteTemplate;
-            sprite.setPosition(state.currentX, y);
-            sprite.setColor(color);
-            
-            // If completed, add a visual indicator (slight rotation)
-            if (state.completed) {
-                sprite.setRotation(15.0f); 
-                continue;
-            }
-            
-            window.draw(sprite);
-            
-            // Draw status indicators background panel
-            sf::RectangleShape statusPanel;
-            statusPanel.setSize(sf::Vector2f(200, 50));
-            statusPanel.setPosition(state.currentX + 25, y - 5);
-            statusPanel.setFillColor(sf::Color(0, 0, 0, static_cast<sf::Uint8>(alpha * 0.7f)));
-            window.draw(statusPanel);
-            
-            // Flight name
-            sf::Text nameLabel(flightName, font, 12);
-            nameLabel.setPosition(state.currentX + 30, y);
-            nameLabel.setFillColor(sf::Color(255, 255, 255, static_cast<sf::Uint8>(alpha)));
-            window.draw(nameLabel);
-            
-            // Draw phase indicator
-            std::string phaseText;
-            switch (state.currentPhase) {
-                case APPROACH: phaseText = "Approaching"; break;
-                case LANDING: phaseText = "Landing"; break;
-                case TAXI: phaseText = "Taxiing"; break;
-                case HOLDING: phaseText = "holding"; break;
-                case TAKEOFF_ROLL: phaseText = "Takeoff"; break;
-                case DEPARTURE: phaseText = "Departing"; break;
-                case AT_GATE: phaseText = "At Gate"; break;
-                case CLIMB: phaseText = "Climbing"; break;
-                default: phaseText = "Unknown";
-            }
-            
-            sf::Text phaseLabel(phaseText, font, 10);
-            phaseLabel.setPosition(state.currentX + 30, y + 15);
-            phaseLabel.setFillColor(sf::Color(200, 200, 200, static_cast<sf::Uint8>(alpha)));
-            window.draw(phaseLabel);
+            // Completed flights have left the field
+            if (state.completed) continue;
             
-            // Draw speed
-            sf::Text speedLabel("Speed: " + std::to_string(static_cast<int>(state.speed)) + " kts", font, 10);
-            speedLabel.setPosition(state.currentX + 30, y + 30);
-            speedLabel.setFillColor(
-                state.speedViolation 
-                    ? sf::Color(255, 100, 100, static_cast<sf::Uint8>(alpha)) 
-                    : sf::Color(150, 255, 150, static_cast<sf::Uint8>(alpha))
-            );
-            window.draw(speedLabel);
+            // Determine Y from assigned runway
+            float y = 220 + state.runwayIndex * spacing;
+            float x = state.currentX;
+            sf::Uint8 a = static_cast<sf::Uint8>(alpha);
             
-            // Draw avionics status
-            std::string avionicsText = state.avionicsActive ? "AVN: ON" : "AVN: OFF";
-            sf::Text avionicsLabel(avionicsText, font, 10);
-            avionicsLabel.setPosition(state.currentX + 120, y + 30);
-            avionicsLabel.setFillColor(
-                state.avionicsActive 
-                    ? sf::Color(150, 255, 150, static_cast<sf::Uint8>(alpha)) 
-                    : sf::Color(255, 150, 150, static_cast<sf::Uint8>(alpha))
-            );
-            window.draw(avionicsLabel);
+            // Color based on phase, bright red for a speed violation
+            sf::Color color = state.speedViolation ? sf::Color(255, 50, 50) : getColorForPhase(state.currentPhase);
+            color.a = a;
+            appendQuad(geometryBatch, x, y, planeSize.x * flightScale.x, planeSize.y * flightScale.y, color, planeTex);
             
-            // Draw runway assignment
-            sf::Text runwayLabel("RWY: " + std::string(1, 'A' + state.runwayIndex), font, 10);
-            runwayLabel.setPosition(state.currentX + 120, y + 15);
-            runwayLabel.setFillColor(sf::Color(200, 200, 200, static_cast<sf::Uint8>(alpha)));
-            window.draw(runwayLabel);
+            // Status indicators background panel
+            appendSolid(x + 25, y - 5, 200, 50, sf::Color(0, 0, 0, static_cast<sf::Uint8>(alpha * 0.7f)));
             
-            // Draw completed status if applicable
-            if (state.completed) {
-                sf::Text completedLabel("COMPLETED", font, 10);
-                completedLabel.setPosition(state.currentX + 120, y);
-                completedLabel.setFillColor(sf::Color(100, 255, 100, static_cast<sf::Uint8>(alpha)));
-                window.draw(completedLabel);
-            }
+            appendLabel(state.nameLabel, flightName, 12, x + 30, y, sf::Color(255, 255, 255, a));
+            appendLabel(state.phaseLabel, phaseName(state.currentPhase), 10, x + 30, y + 15, sf::Color(200, 200, 200, a));
+            appendLabel(state.speedLabel, "Speed: " + std::to_string(static_cast<int>(state.speed)) + " kts", 10,
+                        x + 30, y + 30,
+                        state.speedViolation ? sf::Color(255, 100, 100, a) : sf::Color(150, 255, 150, a));
+            appendLabel(state.avionicsLabel, state.avionicsActive ? "AVN: ON" : "AVN: OFF", 10, x + 120, y + 30,
+                        state.avionicsActive ? sf::Color(150, 255, 150, a) : sf::Color(255, 150, 150, a));
+            appendLabel(state.runwayLabel, "RWY: " + std::string(runwayName(state.runwayIndex)), 10,
+                        x + 120, y + 15, sf::Color(200, 200, 200, a));
         }
         
-        // 5. Draw legend at the bottom
+        // 5. Legend at the bottom
         {
             float legendY = window.getSize().y - 100;
-            sf::Text legendTitle("STATUS INDICATORS:", font, 14);
-            legendTitle.setPosition(30, legendY);
-            legendTitle.setFillColor(sf::Color::White);
-            window.draw(legendTitle);
+            appendLabel(legendTitle, "STATUS INDICATORS:", 14, 30, legendY, sf::Color::White);
             
-            // Status icons
             float xOffset = 30;
             float yOffset = legendY + 25;
-            
-            // Speed violation indicator
-            sf::CircleShape speedViolation(8);
-            speedViolation.setFillColor(sf::Color(255, 50, 50));
-            speedViolation.setPosition(xOffset, yOffset);
-            window.draw(speedViolation);
-            sf::Text speedLabel("Speed Violation", font, 12);
-            speedLabel.setPosition(xOffset + 20, yOffset - 5);
-            speedLabel.setFillColor(sf::Color::White);
-            window.draw(speedLabel);
-            
-            // Avionics status
+            appendCircle(xOffset, yOffset, 8, sf::Color(255, 50, 50));
+            appendLabel(legendLabels[0], "Speed Violation", 12, xOffset + 20, yOffset - 5, sf::Color::White);
             xOffset += 150;
-            sf::CircleShape avionicsIcon(8);
-            avionicsIcon.setFillColor(sf::Color(150, 255, 150));
-            avionicsIcon.setPosition(xOffset, yOffset);
-            window.draw(avionicsIcon);
-            sf::Text avionicsLabel("AVN Active", font, 12);
-            avionicsLabel.setPosition(xOffset + 20, yOffset - 5);
-            avionicsLabel.setFillColor(sf::Color::White);
-            window.draw(avionicsLabel);
-            
-            // Completed status
+            appendCircle(xOffset, yOffset, 8, sf::Color(150, 255, 150));
+            appendLabel(legendLabels[1], "AVN Active", 12, xOffset + 20, yOffset - 5, sf::Color::White);
             xOffset += 150;
-            sf::CircleShape completedIcon(8);
-            completedIcon.setFillColor(sf::Color::White);
-            completedIcon.setPosition(xOffset, yOffset);
-            completedIcon.setRotation(15.0f);
-            window.draw(completedIcon);
-            sf::Text completedLabel("Completed", font, 12);
-            completedLabel.setPosition(xOffset + 20, yOffset - 5);
-            completedLabel.setFillColor(sf::Color::White);
-            window.draw(completedLabel);
+            appendCircle(xOffset, yOffset, 8, sf::Color::White);
+            appendLabel(legendLabels[2], "Completed", 12, xOffset + 20, yOffset - 5, sf::Color::White);
         }
         
-        // 6. Draw current simulation time
-        sf::Text timeDisplay("Simulation Time: T+" + std::to_string(currentTime), font, 18);
-        timeDisplay.setPosition(30, 20);
-        timeDisplay.setFillColor(sf::Color::White);
-        window.draw(timeDisplay);
+        // 6. Current simulation time
+        appendLabel(timeLabel, "Simulation Time: T+" + std::to_string(snap.currentTime), 18, 30, 20, sf::Color::White);
+
+        // 7. Frame-time overlay (F3)
+        if (showFrameStats) {
+            if (frameStart - statsShownAt >= std::chrono::milliseconds(FRAME_STATS_REFRESH_MS)) {
+                statsShownAt = frameStart;
+                updateStatsText(snap, frameStart);
+            }
+            float x = window.getSize().x - 350.0f;
+            appendSolid(x - 10, 5, 350, 62, sf::Color(0, 0, 0, 170));
+            for (int i = 0; i < 3; i++)
+                appendLabel(statsLabels[i], statsText[i], 12, x, 10 + i * 18, sf::Color(150, 255, 150));
+        }
         
+        window.clear();
+        if (assetReady[ASSET_BACKGROUND])
+            window.draw(airportSprite);  // Background
+        window.draw(runwayBatch, sf::RenderStates(&runwayTexture));
+        window.draw(geometryBatch, sf::RenderStates(&atlasTexture));
+        for (auto &batch : textBatches)
+            window.draw(batch.second, sf::RenderStates(&glyphs.texture(batch.first)));
+        float cpuMs = (float)(threadCpuMs() - cpuStart);
         window.display();
+
+        // Interval between two presented frames, so a missed refresh shows up in the overlay
+        auto shown = std::chrono::steady_clock::now();
+        if (lastFrameAt.time_since_epoch().count())
+            frameStats.add(std::chrono::duration<float, std::milli>(shown - lastFrameAt).count(), cpuMs);
+        lastFrameAt = shown;
     }
+
 private:
-    void simulateStep() {
-        if (currentTime > 300) 
-        {//simulationRunning = false;
-        return;}
+    // FPS and frame interval (mean, p99, max), CPU per frame, and how far the picture
+    // is from the simulation, over the last FRAME_STATS_WINDOW frames
+    void updateStatsText(const SimSnapshot &snap, std::chrono::steady_clock::time_point now) {
+        int n = frameStats.count;
+        float intervals[FRAME_STATS_WINDOW];
+        float intervalSum = 0, cpuSum = 0, cpuMax = 0;
+        for (int i = 0; i < n; i++) {
+            intervals[i] = frameStats.intervalMs[i];
+            intervalSum += frameStats.intervalMs[i];
+            cpuSum += frameStats.cpuMs[i];
+            cpuMax = std::max(cpuMax, frameStats.cpuMs[i]);
+        }
+        std::sort(intervals, intervals + n);
+        float mean = n ? intervalSum / n : 0;
+        float p99 = n ? intervals[std::min(n - 1, (int)(n * 0.99f))] : 0;
+        float max = n ? intervals[n - 1] : 0;
+        char line[96];
+        snprintf(line, sizeof(line), "%.1f FPS  frame %.1f ms  p99 %.1f  max %.1f", mean > 0 ? 1000.0f / mean : 0.0f,
+                 mean, p99, max);
+        statsText[0] = line;
+        snprintf(line, sizeof(line), "CPU %.2f ms/frame  max %.2f ms", n ? cpuSum / n : 0.0f, cpuMax);
+        statsText[1] = line;
+        double age = std::chrono::duration<double, std::milli>(now - snap.publishedAt).count();
+        snprintf(line, sizeof(line), "Sim %.1fx  snapshot %.0f ms old  %zu flights", std::max(simRate, 0.0),
+                 snap.version ? age : 0.0, snap.flights.size());
+        statsText[2] = line;
+    }
+};
+#endif // ATC_HEADLESS
 
-        std::vector<Aircraft*> flightsToProcess;
-        
-        {
-            std::lock_guard<std::mutex> lock(scheduledMutex);
-            flightsForThisMinute.clear();
+// pipes
+const char* ATC_TO_AVN_PIPE = "/tmp/atc_to_avn";
 
-            while (scheduledIndex < scheduledFlights.size() &&
-                   scheduledFlights[scheduledIndex]->scheduledTime == currentTime) {
-                flightsForThisMinute.push_back(scheduledFlights[scheduledIndex]);
-                scheduledIndex++;
-            }
-            
+// Create named pipe (FIFO) if it doesn't exist
+void createPipeIfNotExists(const char* path) {
+    if (mkfifo(path, 0666) == -1 && errno != EEXIST) {
+        cerr << "Error creating pipe " << path << ": " << strerror(errno) << endl;
+        exit(1);
+    }
+}
+// Without waitForReader the signal is dropped when no AVN generator is attached
+// (over the ring it is sent by avnEmitter.stop() instead)
+void sendExitSignal(bool waitForReader) {
+    if (avnEmitter.sendsExitOverRing()) return;
+    int fd = open(ATC_TO_AVN_PIPE, waitForReader ? O_WRONLY : (O_WRONLY | O_NONBLOCK));
+    if (fd != -1) {
+        avnWriteExit(fd);
+        close(fd);
+    }
+}
+
+// One-line JSON summary of a finished run, for batch drivers. The seed is the
+// airport's own, which reruns it alone (see main())
+void printRunSummary(const ATCSimulation &sim, long long wallMs) {
+    int completed = 0;
+    vector<int> runwayUse(airport->runwayCount, 0);
+    // Waits are averaged over the flights that got a runway; the others never
+    // recorded one
+    int assigned = 0;
+    long long totalWait = 0;
+    int maxWait = 0;
+    for (auto *list : {&airport->arrivalFlights, &airport->departureFlights}) {
+        for (const Aircraft &f : *list) {
+            int runway = airport->flightTable.assignedRunway[f.id];
+            if (airport->flightTable.completed[f.id]) completed++;
+            if (runway < 0 || runway >= airport->runwayCount) continue;
+            runwayUse[runway]++;
+            assigned++;
+            totalWait += f.waitingTime;
+            maxWait = max(maxWait, f.waitingTime);
         }
-        
-        cout << "Flights scheduled for this minute: " << flightsForThisMinute.size() << endl;
-            if (!flightsForThisMinute.empty()) {
-            // Sort the flights by priority - key change: sort by priority and type before processing
-            sort(flightsForThisMinute.begin(), flightsForThisMinute.end(), 
-                [](Aircraft* a, Aircraft* b) {
-                    // First by emergency status
-                    if (a->isEmergency && !b->isEmergency) return true;
-                    if (!a->isEmergency && b->isEmergency) return false;
-                    
-                  
-                  /*  
-                    // Then by type (MILITARY > MEDICAL > CARGO > COMMERCIAL)
-                    if (a->type != b->type) {
-                        if (a->type == MILITARY) return true;
-                        if (b->type == MILITARY) return false;
-                        if (a->type == MEDICAL) return true;
-                        if (b->type == MEDICAL) return false;
-                        if (a->type == CARGO) return true;
-                        if (b->type == CARGO) return false;
-                    }*/
-                      // Then by priority
-                    if (a->priority != b->priority)
-                        return a->priority > b->priority;
-                    // Finally by arrival time
-                    return a->entryTime < b->entryTime;
-                });
-            
-            cout << "Sorted flights by priority (from highest to lowest):" << endl;
-            for (auto flight : flightsForThisMinute) {
-                cout << "  - " << flight->flightName << " (Priority: " << flight->priority 
-                     << ", Type: " << getAircraftTypeName(flight->type) << ")" << endl;
-            }
-            
-               // Create a copy to work with outside the lock
-            flightsToProcess = flightsForThisMinute;
-            
-            // Process flights in priority order
-            for (auto flight : flightsToProcess) {
-                // Add to active flights
-                {
-                    std::lock_guard<std::mutex> lock(activeMutex);
-                    flight->phaseStartTime = std::chrono::steady_clock::now();
-                    activeFlights.push_back(flight);
-                }
-                
-                cout << "Flight " << flight->flightName << " is now active at time " << currentTime << endl;
+    }
 
-                // Create a thread for each flight but use a modified flightLifecycle function
-                flightThreads.push_back(std::thread([flight, this]() {
-                    // Set thread-local current time for this flight
-                    flight->entryTime = currentTime;
-                    
-                    // Call the modified flightLifecycle
-                    flightLifecycle(flight);
-                }));
-                
-                // Brief pause to allow thread setup and prevent race conditions
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    double fines = 0;
+    for (const AVN &avn : airport->aviationViolationNotices) fines += avn.fineAmount;
+    size_t total = sim.totalFlights();
+
+    std::string use;
+    for (int i = 0; i < airport->runwayCount; i++)
+        use += (i ? "," : "") + std::to_string(runwayUse[i]);
+
+    std::string tag;
+    if (airport->code[0]) tag = std::string("\"airport\":\"") + airport->code + "\",";
+
+    printf("{%s\"flights\":%zu,\"admitted\":%zu,\"completed\":%d,\"groundFaults\":%d,"
+           "\"avns\":%zu,\"finesPKR\":%.2f,\"runwayAssignments\":[%s],"
+           "\"assigned\":%d,\"avgWaitSec\":%.2f,\"maxWaitSec\":%d,\"simTime\":%d,\"events\":%lld,"
+           "\"handoffs\":%lld,\"avgHandoffUs\":%.2f,\"maxHandoffUs\":%.2f,"
+           "\"virtualClock\":%s,\"seed\":%llu,\"wallMs\":%lld}\n",
+           tag.c_str(), total, sim.admittedFlights(), completed, airport->groundFaultCount.load(),
+           airport->aviationViolationNotices.size(), fines, use.c_str(),
+           assigned, assigned ? (double)totalWait / assigned : 0.0, maxWait, sim.getCurrentTime(), sim.eventsProcessed(),
+           airport->runwayArbiter->handoffCount(), airport->runwayArbiter->avgHandoffUs(), airport->runwayArbiter->maxHandoffUs(),
+           airport->clock.isVirtual ? "true" : "false", (unsigned long long)airport->seed, wallMs);
+    fflush(stdout);
+}
+
+// Microbenchmarks of the core operations (--bench). Every case runs BENCH_REPS
+// times on a fresh scratch airport and reports the median and best ns per
+// operation; the whole suite is one JSON line on stdout for nightly comparisons.
+const int BENCH_REPS = 5;
+const char* BENCH_AVN_PIPE = "/tmp/atc_bench_avn";
+
+struct BenchResult {
+    std::string name;
+    std::string params;      // extra JSON fields, starting with a comma
+    long long ops;
+    double nsPerOp;
+    double minNsPerOp;
+};
+
+// rep() prepares its own state and returns the ns spent on the ops it times
+static BenchResult benchmark(const char* name, const std::string &params, long long ops,
+                             const std::function<double()> &rep) {
+    vector<double> ns;
+    for (int i = 0; i < BENCH_REPS; i++) ns.push_back(rep() / ops);
+    std::sort(ns.begin(), ns.end());
+    BenchResult result = {name, params, ops, ns[ns.size() / 2], ns[0]};
+    fprintf(stderr, "%-28s%-22s %10.1f ns/op\n", name, params.empty() ? "" : params.c_str() + 1, result.nsPerOp);
+    return result;
+}
+
+static double nsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A scratch airport with the default runways and `flights` seeded flights, all
+// scheduled at minute 0, entered on the calling thread
+static std::unique_ptr<Airport> benchAirport(int flights) {
+    std::unique_ptr<Airport> bench(new Airport());
+    enterAirport(bench.get());
+    configureRunways(defaultRunwayTopology());
+
+    SplitMix64 rng(42);
+    airport->arrivalFlights.reserve(flights);
+    airport->departureFlights.reserve(flights);
+    airport->flightTable.reserve(flights);
+    for (int i = 0; i < flights; i++) {
+        Aircraft flight;
+        snprintf(flight.flightName, sizeof(flight.flightName), "BN%d", i);
+        strcpy(flight.airline, "Bench");
+        flight.type = rng.range(COMMERCIAL, MEDICAL);
+        flight.direction = i % 4;
+        flight.airlinenumber = 0;
+        flight.scheduledTime = 0;
+        flight.priority = rng.range(0, 999);
+        prepareFlight(flight, false);
+        if (flight.direction == DIR_NORTH || flight.direction == DIR_SOUTH)
+            airport->arrivalFlights.push_back(flight);
+        else
+            airport->departureFlights.push_back(flight);
+    }
+    for (auto *list : {&airport->arrivalFlights, &airport->departureFlights}) {
+        for (Aircraft &f : *list) {
+            airport->flightTable.record[f.id] = &f;
+            airport->flightIdByName.emplace(f.flightName, f.id);
+        }
+    }
+    return bench;
+}
+
+// One op: request a runway, wait for the handoff if parked, release it. Every op
+// uses a fresh flight, as a flight asks for a runway once in its life.
+static double benchRunwayCycle(int threads, int ops) {
+    auto bench = benchAirport(ops);
+    std::unique_ptr<std::atomic<uint8_t>[]> granted(new std::atomic<uint8_t>[ops]);
+    for (int i = 0; i < ops; i++) granted[i] = 0;
+    bench->runwayArbiter->onGrant = [&granted](Aircraft *flight, RunwayArbiter::Clock::time_point) {
+        granted[flight->id].store(1, std::memory_order_release);
+    };
+
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            enterAirport(bench.get());
+            ready++;
+            while (!go) std::this_thread::yield();
+            for (int id = t; id < ops; id += threads) {
+                if (!airport->runwayArbiter->request(airport->flightTable.record[id])) {
+                    while (!granted[id].load(std::memory_order_acquire))
+                        std::this_thread::yield();
+                }
+                freeRunway(id);
             }
+        });
+    }
+    while (ready < threads) std::this_thread::yield();
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto &w : workers) w.join();
+    return nsSince(start);
+}
+
+// One op: a flight's speed monitoring and violation check for one tick
+static double benchFlightTick(int flights, int ticks) {
+    auto bench = benchAirport(flights);
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < ticks; t++) {
+        for (int id = 0; id < flights; id++) {
+            airport->flightTable.beginWrite(id);
+            monitorSpeed(id);
+            airport->flightTable.endWrite(id);
+            checkSpeedViolations(id);
+            airport->flightTable.tick[id]++;
         }
-        
-        // Display runway status
-        cout << "\nCurrent Runway Status:" << endl;
-        {
-            std::lock_guard<std::mutex> lock(runwayMutex);
-            for (int i = 0; i < 3; i++) {
-                cout << "  Runway " << (char)('A' + i) << ": " 
-                     << (runways[i].isAvailable ? "Available" : "Occupied by " + string(runways[i].currentFlight)) << endl;
+    }
+    return nsSince(start);
+}
+
+// One op: generateAVN() on the flight thread. With a reader the time runs until
+// the reader has every record, so it is the delivered rate. Records the emitter
+// dropped are added to dropped.
+static double benchGenerateAVN(int ops, bool withReader, long long &dropped) {
+    auto bench = benchAirport(1);
+    const Aircraft &flight = *airport->flightTable.record[0];
+    std::atomic<bool> readerDone{false};
+    std::atomic<long long> received{0};
+    std::thread reader;
+    if (withReader) {
+        // O_RDWR opens without waiting for a writer and never sees end of file
+        int fd = open(BENCH_AVN_PIPE, O_RDWR);
+        reader = std::thread([fd, &received, &readerDone]() {
+            static char buffer[1 << 16];
+            long long bytes = 0;
+            while (!readerDone) {
+                struct pollfd pfd = {fd, POLLIN, 0};
+                if (poll(&pfd, 1, 50) <= 0) continue;
+                ssize_t n = read(fd, buffer, sizeof(buffer));
+                if (n > 0) bytes += n;
+                received = bytes / (long long)sizeof(AvnRecord);
             }
+            close(fd);
+        });
+    }
+    avnEmitter.start(BENCH_AVN_PIPE, false);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ops; i++)
+        generateAVN(flight, 400 + (i & 255), 290);
+    if (withReader) {
+        // A dropped record never arrives; the run is reported invalid
+        while (received + avnEmitter.droppedCount() < ops && nsSince(start) < 10e9)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    double ns = nsSince(start);
+
+    avnEmitter.stop();
+    dropped += avnEmitter.droppedCount();
+    if (withReader) dropped += ops - std::min<long long>(ops, received + avnEmitter.droppedCount());
+    readerDone = true;
+    if (reader.joinable()) reader.join();
+    return ns;
+}
+
+// One op: findFlightIndex() of an active flight, by name
+static double benchFindFlightIndex(int active, int ops) {
+    auto bench = benchAirport(active);
+    vector<const char*> names;
+    for (int id = 0; id < active; id++) {
+        airport->activeFlights.insert(airport->flightTable.record[id]);
+        names.push_back(airport->flightTable.record[id]->flightName);
+    }
+    std::shuffle(names.begin(), names.end(), SplitMix64(7));
+
+    long long sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ops; i++)
+        sum += findFlightIndex(names[i % active]);
+    double ns = nsSince(start);
+    if (sum < 0) fprintf(stderr, "unexpected index sum\n");
+    return ns;
+}
+
+// One op: admission of one flight by a simulateStep() that admits `flights` at once
+static double benchAdmission(int flights) {
+    auto bench = benchAirport(flights);
+    ATCSimulation sim(true);
+    auto start = std::chrono::steady_clock::now();
+    sim.step();
+    return nsSince(start);
+}
+
+int runBenchmarks() {
+    logger.setLevel(LOG_OFF);
+    cout.setstate(std::ios::failbit);   // no dashboard from simulateStep()
+    createPipeIfNotExists(BENCH_AVN_PIPE);
+
+    vector<BenchResult> results;
+    for (int threads : {1, 8, 64}) {
+        results.push_back(benchmark("runway_acquire_release", ",\"threads\":" + std::to_string(threads), 100000,
+                                    [threads]() { return benchRunwayCycle(threads, 100000); }));
+    }
+    results.push_back(benchmark("flight_tick", ",\"flights\":10000", 10000LL * 100,
+                                []() { return benchFlightTick(10000, 100); }));
+    // With a reader every record must arrive, or the delivered rate means nothing
+    bool valid = true;
+    for (bool withReader : {false, true}) {
+        long long dropped = 0;
+        results.push_back(benchmark("generate_avn", withReader ? ",\"reader\":true" : ",\"reader\":false", 50000,
+                                    [withReader, &dropped]() { return benchGenerateAVN(50000, withReader, dropped); }));
+        results.back().params += ",\"dropped\":" + std::to_string(dropped);
+        if (withReader && dropped) {
+            results.back().params += ",\"valid\":false";
+            fprintf(stderr, "generate_avn: the reader missed %lld records; measurement invalid\n", dropped);
+            valid = false;
         }
-        
-        // Display dashboard
-        {
-            std::lock_guard<std::mutex> lock(displayMutex);
-            displayDashboard(currentTime);
-        }
-      
-   auto now = std::chrono::steady_clock::now();
-  currentTime = std::chrono::duration_cast<std::chrono::seconds>(now - currStartTime).count();
+    }
+    for (int active : {10, 100, 1000, 10000, 100000}) {
+        results.push_back(benchmark("find_flight_index", ",\"activeFlights\":" + std::to_string(active), 1000000,
+                                    [active]() { return benchFindFlightIndex(active, 1000000); }));
+    }
+    for (int batch : {1000, 10000, 100000}) {
+        results.push_back(benchmark("simulate_step_admission", ",\"batch\":" + std::to_string(batch), batch,
+                                    [batch]() { return benchAdmission(batch); }));
+    }
+    unlink(BENCH_AVN_PIPE);
 
+    printf("{\"suite\":\"atc-core\",\"reps\":%d,\"hardwareThreads\":%u,\"results\":[", BENCH_REPS,
+           std::thread::hardware_concurrency());
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        printf("%s{\"name\":\"%s\"%s,\"ops\":%lld,\"nsPerOp\":%.2f,\"minNsPerOp\":%.2f,\"opsPerSec\":%.0f}",
+               i ? "," : "", r.name.c_str(), r.params.c_str(), r.ops, r.nsPerOp, r.minNsPerOp,
+               r.nsPerOp > 0 ? 1e9 / r.nsPerOp : 0.0);
     }
-    
-    
-    
-};
+    printf("]}\n");
+    fflush(stdout);
+    return valid ? 0 : 1;
+}
 
-// pipes
-const char* ATC_TO_AVN_PIPE = "/tmp/atc_to_avn";
+// Summary of a replay; the counters match the summary of the recorded run
+void printReplaySummary(const JournalReplay &replay, long long wallMs) {
+    int completed = 0;
+    vector<int> runwayUse(airport->runwayCount, 0);
+    for (size_t id = 0; id < airport->flightTable.size(); id++) {
+        int runway = airport->flightTable.assignedRunway[id];
+        if (airport->flightTable.completed[id]) completed++;
+        if (runway >= 0 && runway < airport->runwayCount) runwayUse[runway]++;
+    }
+    double fines = 0;
+    for (const AVN &avn : airport->aviationViolationNotices) fines += avn.fineAmount;
+    std::string use;
+    for (int i = 0; i < airport->runwayCount; i++)
+        use += (i ? "," : "") + std::to_string(runwayUse[i]);
 
-// Create named pipe (FIFO) if it doesn't exist
-void createPipeIfNotExists(const char* path) {
-    if (mkfifo(path, 0666) == -1 && errno != EEXIST) {
-        cerr << "Error creating pipe " << path << ": " << strerror(errno) << endl;
-        exit(1);
+    printf("{\"replay\":true,\"events\":%zu,\"applied\":%zu,\"journalMs\":%lld,\"flights\":%zu,"
+           "\"completed\":%d,\"groundFaults\":%d,\"avns\":%zu,\"finesPKR\":%.2f,"
+           "\"runwayAssignments\":[%s],\"speed\":%g,\"wallMs\":%lld}\n",
+           replay.events(), replay.eventsApplied(), replay.endMs(), airport->flightTable.size(), completed,
+           airport->groundFaultCount.load(), airport->aviationViolationNotices.size(), fines, use.c_str(),
+           replay.speed, wallMs);
+    fflush(stdout);
+}
+
+// Export the counters and gauges of one airport, labelled with its code when the
+// controller runs several
+void registerAirportMetrics(Airport *a) {
+    std::string label = a->code[0] ? std::string("airport=\"") + a->code + "\"" : "";
+    std::string sep = label.empty() ? "" : ",";
+    metrics.counter("atc_flights_admitted_total", "Flights admitted into the active set", label, a->flightsAdmitted);
+    metrics.counter("atc_flights_completed_total", "Flights that reached the end of their last phase", label,
+                    a->flightsCompleted);
+    metrics.counter("atc_runway_assignments_total", "Runways granted to flights", label, a->runwayAssignments);
+    metrics.counter("atc_avns_issued_total", "Airspace violation notices issued", label, a->avnsIssued);
+    metrics.counter("atc_ground_faults_total", "Flights removed by a ground fault", label,
+                    [a]() { return (double)a->groundFaultCount.load(); });
+    metrics.gauge("atc_active_flights", "Flights in the active set", label, [a]() {
+        std::lock_guard<std::mutex> lock(a->activeMutex);
+        return (double)a->activeFlights.size();
+    });
+    metrics.gauge("atc_flights_waiting_for_runway", "Admitted flights not yet granted a runway", label, [a]() {
+        return (double)a->flightsAdmitted.value() - (double)a->runwayAssignments.value();
+    });
+    metrics.gauge("atc_runway_occupancy_ratio", "Share of runways held by a flight", label, [a]() {
+        int held = 0;
+        for (int i = 0; i < a->runwayCount; i++) held += !a->runways[i].isAvailable();
+        return a->runwayCount ? (double)held / a->runwayCount : 0.0;
+    });
+    for (int i = 0; i < a->runwayCount; i++) {
+        const Runway *runway = &a->runways[i];
+        metrics.gauge("atc_runway_occupied", "1 while the runway is held by a flight",
+                      label + sep + "runway=\"" + runway->name + "\"",
+                      [runway]() { return runway->isAvailable() ? 0.0 : 1.0; });
     }
+    metrics.gauge("atc_sim_time_seconds", "Simulation clock", label,
+                  [a]() { return a->clock.elapsedMs() / 1000.0; });
 }
-void sendExitSignal() {
-    int fd = open(ATC_TO_AVN_PIPE, O_WRONLY);
-    if (fd != -1) {
-        const char* exitMsg = "EXIT";
-        write(fd, exitMsg, strlen(exitMsg));
-        close(fd);
+
+// Start the event journal of the calling thread's airport; the flights must be
+// bound to their ids (the simulation constructed) and the clock started
+bool openJournal(const char* path) {
+    JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = JOURNAL_MAGIC;
+    header.version = JOURNAL_VERSION;
+    header.airportId = (uint16_t)airport->id;
+    memcpy(header.code, airport->code, sizeof(header.code));
+    header.runwayCount = airport->runwayCount;
+    header.flightCount = (uint32_t)airport->flightTable.size();
+    header.originWall = airport->clock.originWall;
+    header.seed = airport->seed;
+    header.virtualClock = airport->clock.isVirtual;
+
+    vector<JournalRunway> runways(airport->runwayCount);
+    for (int i = 0; i < airport->runwayCount; i++) {
+        memcpy(runways[i].name, airport->runways[i].name, sizeof(runways[i].name));
+        runways[i].ops = airport->runways[i].ops;
+    }
+    vector<JournalFlight> flights(airport->flightTable.size());
+    for (size_t id = 0; id < flights.size(); id++) {
+        const Aircraft &f = *airport->flightTable.record[id];
+        JournalFlight &out = flights[id];
+        memset(&out, 0, sizeof(out));
+        memcpy(out.flightName, f.flightName, sizeof(out.flightName));
+        memcpy(out.airline, f.airline, sizeof(out.airline));
+        out.type = f.type;
+        out.direction = f.direction;
+        out.isEmergency = f.isEmergency;
+        out.scheduledTime = f.scheduledTime;
+        out.priority = f.priority;
+    }
+
+    Airport *home = airport;
+    airport->journal.reset(new JournalWriter());
+    if (!airport->journal->open(path, header, runways, flights, [home]() { return home->clock.elapsedMs(); })) {
+        cerr << "Could not create event journal " << path << ": " << strerror(errno) << endl;
+        airport->journal.reset();
+        return false;
     }
+    return true;
 }
 
-int main() {
-    srand(time(0));
+// Pack the window's assets from dir into the bundle beside the binary
+bool packAssets(const char* dir) {
+    std::string source = dir;
+    if (!source.empty() && source.back() != '/') source += '/';
+    std::string bundlePath = executableDir() + ASSET_BUNDLE_FILE;
+    vector<std::string> names(std::begin(ASSET_FILES), std::end(ASSET_FILES));
+    if (!AssetBundle::pack(bundlePath, source, names)) {
+        cerr << "Could not pack the assets of " << dir << " into " << bundlePath << ": " << strerror(errno) << endl;
+        return false;
+    }
+    cout << "Packed " << names.size() << " assets into " << bundlePath << endl;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    bool virtualClock = false;
+    bool quiet = false;
+#ifdef ATC_HEADLESS
+    bool headless = true;
+#else
+    bool headless = false;
+#endif
+    unsigned int seed = time(0);
+    const char* scenarioPath = NULL;
+    const char* writePath = NULL;
+    const char* runwayPath = NULL;
+    const char* networkPath = NULL;
+    const char* journalPath = NULL;
+    const char* replayPath = NULL;
+    const char* packDir = NULL;
+    JournalReplay replay;
+    int logLevel = -1;
+    bool generate = false;
+    bool bench = false;
+    bool badArgs = false;
+    TrafficProfile traffic;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--virtual-clock") == 0) {
+            virtualClock = true;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            scenarioPath = argv[++i];
+        } else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+            generate = true;
+            traffic.flightsPerMinute = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--gen-minutes") == 0 && i + 1 < argc) {
+            traffic.minutes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--traffic-mix") == 0 && i + 1 < argc) {
+            double *m = traffic.typeMix;
+            if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &m[0], &m[1], &m[2], &m[3]) != 4) badArgs = true;
+        } else if (strcmp(argv[i], "--arrival-share") == 0 && i + 1 < argc) {
+            traffic.arrivalShare = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--priority-range") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d,%d", &traffic.priorityMin, &traffic.priorityMax) != 2) badArgs = true;
+        } else if (strcmp(argv[i], "--emergency-rate") == 0 && i + 1 < argc) {
+            traffic.emergencyRate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--surge") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d,%d,%lf", &traffic.surgeStart, &traffic.surgeEnd, &traffic.surgeFactor) != 3) badArgs = true;
+        } else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            static const char* levels[] = {"debug", "info", "warn", "error", "off"};
+            const char* name = argv[++i];
+            for (int l = LOG_DEBUG; l <= LOG_OFF; l++)
+                if (strcmp(name, levels[l]) == 0) logLevel = l;
+            if (logLevel == -1) badArgs = true;
+        } else if (strcmp(argv[i], "--runways") == 0 && i + 1 < argc) {
+            runwayPath = argv[++i];
+        } else if (strcmp(argv[i], "--airports") == 0 && i + 1 < argc) {
+            networkPath = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            journalPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc) {
+            replay.speed = atof(argv[++i]);
+            if (replay.speed < 1 || replay.speed > 10000) badArgs = true;
+        } else if (strcmp(argv[i], "--replay-from") == 0 && i + 1 < argc) {
+            replay.startMs = (long long)(atof(argv[++i]) * 1000);
+        } else if (strcmp(argv[i], "--write-scenario") == 0 && i + 1 < argc) {
+            writePath = argv[++i];
+        } else if (strcmp(argv[i], "--pack-assets") == 0 && i + 1 < argc) {
+            packDir = argv[++i];
+        } else {
+            badArgs = true;
+        }
+    }
+
+    if (const char* problem = traffic.problem()) {
+        cerr << problem << endl;
+        badArgs = true;
+    }
+    if (badArgs) {
+        cerr << "Usage: " << argv[0] << " [--headless] [--virtual-clock] [--seed N] [--quiet] [--runways FILE]\n"
+             << "       [--airports FILE] [--journal FILE]\n"
+             << "       [--replay FILE [--replay-speed 1-10000] [--replay-from SEC]] [--bench]\n"
+             << "       [--log-level debug|info|warn|error|off]\n"
+             << "       [--scenario FILE | --generate FLIGHTS_PER_MIN [--gen-minutes M]\n"
+             << "        [--traffic-mix C,CG,MIL,MED] [--arrival-share F] [--priority-range LO,HI]\n"
+             << "        [--emergency-rate F] [--surge START,END,FACTOR]] [--write-scenario FILE]\n"
+             << "       " << argv[0] << " --pack-assets DIR" << endl;
+        return 1;
+    }
+
+    if (bench) return runBenchmarks();
+    if (packDir) return packAssets(packDir) ? 0 : 1;
+
+    // Quiet runs keep stdout for the summary line only
+    if (quiet) cout.setstate(std::ios::failbit);
+    logger.setLevel(logLevel != -1 ? logLevel : quiet ? LOG_ERROR : LOG_INFO);
+
+    // Without --airports the run is one unnamed airport
+    vector<AirportSpec> network(1, AirportSpec{"", "", ""});
+    if (networkPath && !loadAirportNetwork(networkPath, network)) return 1;
+    if (network.size() > 1 && !headless) {
+        cerr << "A multi-airport run has no window; add --headless" << endl;
+        return 1;
+    }
+    if (replayPath && (networkPath || journalPath || writePath)) {
+        cerr << "--replay plays back one airport's journal; it takes no --airports, --journal or --write-scenario" << endl;
+        return 1;
+    }
+
+    // Load every airport; each shard is pinned to its own core when there are several
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < network.size(); i++) {
+        airports.emplace_back(new Airport());
+        airport = airports.back().get();
+        airport->id = (int)i;
+        strcpy(airport->code, network[i].code);
+        // Airport i runs on seed + i, for its flight ticks and its generated traffic
+        // alike, so `--seed` with that value reruns the shard alone
+        airport->seed = seed + (unsigned int)i;
+        airport->core = network.size() > 1 ? (int)(i % cores) : -1;
+
+        // A replay takes the runways and flights from the journal
+        if (replayPath) {
+            if (!replay.load(replayPath)) return 1;
+            continue;
+        }
+
+        const char* topologyPath = network[i].runways[0] ? network[i].runways : runwayPath;
+        vector<RunwaySpec> topology = defaultRunwayTopology();
+        if (topologyPath && !loadRunwayTopology(topologyPath, topology)) return 1;
+        if (!configureRunways(topology)) return 1;
+
+        const char* flightsPath = network[i].scenario[0] ? network[i].scenario : scenarioPath;
+        if (flightsPath) {
+            if (!loadScenarioFile(flightsPath)) return 1;
+        } else if (generate) {
+            traffic.seed = airport->seed;
+            generateTraffic(traffic);
+        } else {
+            getFlightData();
+        }
+    }
+    airport = airports[0].get();
+
+    // Scenario authoring only: save the (first airport's) flights and skip the simulation
+    if (writePath) {
+        return writeScenarioFile(writePath) ? 0 : 1;
+    }
+
     createPipeIfNotExists(ATC_TO_AVN_PIPE);
-    getFlightData();
 
-    Visualizer().runSFML();
+    auto wallStart = std::chrono::steady_clock::now();
+    vector<std::unique_ptr<ATCSimulation>> sims;
+    for (auto &a : airports) {
+        airport = a.get();
+        sims.emplace_back(new ATCSimulation(virtualClock || replayPath));
+        // Several airports keep one journal each, named after the airport code.
+        // Opened before the logger and emitter threads start, so a bad path exits cleanly.
+        if (journalPath) {
+            std::string path = journalPath;
+            if (airports.size() > 1) path += std::string(".") + airport->code;
+            if (!openJournal(path.c_str())) return 1;
+        }
+    }
+    airport = airports[0].get();
+    logger.start();
+    avnEmitter.start(ATC_TO_AVN_PIPE);
+    // Runway latency percentiles go to LATENCY_LOG every LATENCY_REPORT_MS and at exit
+    LatencyReporter latency("atc");
+    for (auto &a : airports) registerAirportMetrics(a.get());
+    avnEmitter.registerMetrics();
+    metrics.counter("atc_log_lines_dropped_total", "Log lines dropped because their thread's ring was full", "",
+                    []() { return (double)logger.droppedCount(); });
+    metrics.startExport("atc");
+    if (!replayPath) {
+        for (auto &a : airports) {
+            latency.add("runway_wait", a->code, &a->runwayWait);
+            latency.add("runway_handoff", a->code, &a->runwayHandoff);
+        }
+        latency.start();
+    }
+    if (replayPath) {
+        replay.index();
+        sims[0]->replayFrom(&replay);
+    }
+    if (headless) {
+        // One shard thread per airport; AVNs of all shards meet in avnEmitter
+        std::atomic<bool> running{true};
+        vector<std::thread> shards;
+        for (auto &sim : sims) {
+            ATCSimulation *shard = sim.get();
+            shards.emplace_back([shard, &running]() {
+                shard->run(running);
+                shard->finish();
+            });
+        }
+        for (auto &t : shards) t.join();
+    }
+#ifndef ATC_HEADLESS
+    else {
+        Visualizer(*sims[0]).runSFML();
+    }
+#endif
+    latency.stop();
+    for (auto &a : airports) {
+        if (!a->journal) continue;
+        if (a->journal->close())
+            logger.log(LOG_INFO, "Event journal %s: %lld events", a->code, a->journal->eventsWritten());
+        else
+            cerr << "Could not write the event journal of " << (a->code[0] ? a->code : "the airport") << endl;
+    }
+    avnEmitter.stop();
+    metrics.stopExport();   // after the emitter, so the final file counts its last flush
+    logger.stop();
+
+    sendExitSignal(!headless);
 
-    sendExitSignal();
+    if (headless) {
+        long long wallMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - wallStart).count();
+        for (size_t i = 0; i < sims.size(); i++) {
+            airport = airports[i].get();
+            if (replayPath)
+                printReplaySummary(replay, wallMs);
+            else
+                printRunSummary(*sims[i], wallMs);
+        }
+    }
     return 0;
 }
 
@@ -934,163 +3687,376 @@ void getFlightData() {
             cin.clear();
             cin.ignore(10000, '\n');
         }
-        // Set emergency based on type
-        if (flight.type == MILITARY || flight.type == MEDICAL || emer) {
-            flight.isEmergency = true;
+        prepareFlight(flight, emer);
+        if (flight.isEmergency) {
             cout<<"flight is set emer"<<endl;
-        } 
-
-        flight.phase = (flight.direction == DIR_NORTH || flight.direction == DIR_SOUTH) ? HOLDING : AT_GATE;
-        flight.isAssigned = false;
-        flight.completed = false;
-        flight.waitingTime = 0;
-        flight.waitStartTime = std::chrono::steady_clock::now();
-        flight.assignedRunway = -1;
-        flight.entryTime = time(NULL);
-        flight.hasSpeedViolation = false;
-    
-        if(flight.phase==HOLDING) flight.speed=600;
-        else flight.speed=0;
+        }
+
+        if (flight.direction == DIR_NORTH || flight.direction == DIR_SOUTH)
+            airport->arrivalFlights.push_back(flight);
+        else
+            airport->departureFlights.push_back(flight);
+    }
+
+    for (auto f : airport->arrivalFlights) arrivalQueue.push(f);
+    for (auto f : airport->departureFlights) departureQueue.push(f);
+}
+
+// Initial state of a flight once its schedule fields are filled in
+void prepareFlight(Aircraft &flight, bool emergency) {
+    // Set emergency based on type
+    flight.isEmergency = (flight.type == MILITARY || flight.type == MEDICAL || emergency);
+
+    int phase = (flight.direction == DIR_NORTH || flight.direction == DIR_SOUTH) ? HOLDING : AT_GATE;
+    int speed = (phase == HOLDING) ? 600 : 0;
+    flight.id = airport->flightTable.add(flight.type, flight.direction, phase, speed);
+
+    flight.waitingTime = 0;
+    flight.waitStartTime = airport->clock.now();
+    flight.entryTime = time(NULL);
+}
+
+// Copy one CSV field into out (truncated to cap-1 chars, surrounding blanks
+// trimmed) and step past its comma
+static const char* scanTextField(const char* p, const char* end, char* out, size_t cap) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    size_t n = 0;
+    while (p < end && *p != ',') {
+        if (n + 1 < cap) out[n++] = *p;
+        p++;
+    }
+    while (n > 0 && (out[n - 1] == ' ' || out[n - 1] == '\t' || out[n - 1] == '\r')) n--;
+    out[n] = '\0';
+    return (p < end) ? p + 1 : p;
+}
+
+// Parse one non-negative integer field of at most 9 digits, so it cannot overflow,
+// and step past its comma; NULL on bad input
+static const char* scanIntField(const char* p, const char* end, int &out) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p >= end || *p < '0' || *p > '9') return NULL;
+    int value = 0;
+    int digits = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (++digits > 9) return NULL;
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    if (p < end && *p != ',') return NULL;
+    out = value;
+    return (p < end) ? p + 1 : p;
+}
+
+// Bulk alternative to getFlightData(). The file is memory-mapped and parsed in a
+// single pass, one flight per line:
+//   flightName,airline,type,direction,scheduledTime,priority,emergency
+// type and direction use the codes of the interactive prompts, emergency is 0 or 1.
+// Blank lines, '#' comments and "flightName,..." header lines are skipped anywhere,
+// so files can be concatenated. Fields may be padded with blanks. Flight names must
+// be unique, as AVNs and payments find a flight by its name.
+bool loadScenarioFile(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        cerr << "Could not open scenario " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        cerr << "Could not stat scenario " << path << ": " << strerror(errno) << endl;
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    const char* data = (const char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        cerr << "Could not map scenario " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    madvise((void*)data, size, MADV_SEQUENTIAL);
+
+    // Upper bound from the shortest possible line; untouched capacity is never paged in
+    size_t estimate = size / 16 + 1;
+    airport->arrivalFlights.reserve(airport->arrivalFlights.size() + estimate);
+    airport->departureFlights.reserve(airport->departureFlights.size() + estimate);
+    airport->flightTable.reserve(airport->flightTable.size() + estimate);
 
-        strcpy(flight.status, "Waiting");
+    const char* end = data + size;
+    const char* line = data;
+    int lineNo = 0;
+    bool ok = true;
+    std::unordered_map<std::string, int> nameLines;   // flight name -> line it is on
+    nameLines.reserve(estimate);
+    while (line < end) {
+        const char* eol = (const char*)memchr(line, '\n', end - line);
+        if (!eol) eol = end;
+        lineNo++;
+
+        const char* p = line;
+        const char* next = eol + (eol < end ? 1 : 0);
+        if (p == eol || *p == '#' || *p == '\r' || (eol - p >= 11 && memcmp(p, "flightName,", 11) == 0)) {
+            line = next;
+            continue;
+        }
+
+        Aircraft flight;
+        int emer = 0;
+        flight.airlinenumber = 0;
+        p = scanTextField(p, eol, flight.flightName, sizeof(flight.flightName));
+        p = scanTextField(p, eol, flight.airline, sizeof(flight.airline));
+        if ((p = scanIntField(p, eol, flight.type)) == NULL ||
+            (p = scanIntField(p, eol, flight.direction)) == NULL ||
+            (p = scanIntField(p, eol, flight.scheduledTime)) == NULL ||
+            (p = scanIntField(p, eol, flight.priority)) == NULL ||
+            (p = scanIntField(p, eol, emer)) == NULL ||
+            flight.flightName[0] == '\0' || flight.type > 3 || flight.direction > 3 ||
+            flight.priority > 999 || emer > 1) {
+            cerr << "Scenario " << path << " line " << lineNo << ": invalid flight record" << endl;
+            ok = false;
+            break;
+        }
+        auto named = nameLines.emplace(flight.flightName, lineNo);
+        if (!named.second) {
+            cerr << "Scenario " << path << " line " << lineNo << ": duplicate flight name "
+                 << flight.flightName << " (first on line " << named.first->second << ")" << endl;
+            ok = false;
+            break;
+        }
 
+        prepareFlight(flight, emer);
         if (flight.direction == DIR_NORTH || flight.direction == DIR_SOUTH)
-            arrivalFlights.push_back(flight);
+            airport->arrivalFlights.push_back(flight);
         else
-            departureFlights.push_back(flight);
+            airport->departureFlights.push_back(flight);
+
+        line = next;
+    }
+
+    munmap((void*)data, size);
+    return ok;
+}
+
+// Write the loaded flights back out in the scenario format read by loadScenarioFile()
+bool writeScenarioFile(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        cerr << "Could not create scenario " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    static char buffer[1 << 20];
+    setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+
+    fprintf(out, "flightName,airline,type,direction,scheduledTime,priority,emergency\n");
+    for (auto *list : {&airport->arrivalFlights, &airport->departureFlights}) {
+        for (const Aircraft &f : *list) {
+            bool typeEmergency = (f.type == MILITARY || f.type == MEDICAL);
+            fprintf(out, "%s,%s,%d,%d,%d,%d,%d\n", f.flightName, f.airline, f.type, f.direction,
+                    f.scheduledTime, f.priority, (f.isEmergency && !typeEmergency) ? 1 : 0);
+        }
     }
 
-    for (auto f : arrivalFlights) arrivalQueue.push(f);
-    for (auto f : departureFlights) departureQueue.push(f);
+    bool ok = (fclose(out) == 0);
+    if (!ok) cerr << "Could not write scenario " << path << ": " << strerror(errno) << endl;
+    return ok;
+}
+
+// Fill arrivalFlights/departureFlights with seeded synthetic traffic: a Poisson
+// number of flights per minute, then type, direction, priority and emergency
+// drawn from the profile. The same profile and seed always give the same flights.
+void generateTraffic(const TrafficProfile &profile) {
+    struct AirlineCode { const char* name; const char* code; int number; };
+    static const AirlineCode airlinesByType[4][2] = {
+        {{"PIA", "PK", 1}, {"AirBlue", "PA", 3}},                                    // COMMERCIAL
+        {{"FedEx", "FX", 4}, {"Blue Dart", "BZ", 5}},                                // CARGO
+        {{"Pakistan Airforce", "PAF", 2}, {"Pakistan Airforce", "PAF", 2}},          // MILITARY
+        {{"Agha Khan Air Ambulance", "AKA", 6}, {"Agha Khan Air Ambulance", "AKA", 6}} // MEDICAL
+    };
+
+    SplitMix64 rng(profile.seed);
+    double mixTotal = 0;
+    for (double w : profile.typeMix) mixTotal += w;
+
+    double expected = profile.flightsPerMinute * profile.minutes;
+    airport->arrivalFlights.reserve(airport->arrivalFlights.size() + (size_t)(expected * profile.arrivalShare * 1.2) + 16);
+    airport->departureFlights.reserve(airport->departureFlights.size() + (size_t)(expected * (1 - profile.arrivalShare) * 1.2) + 16);
+    airport->flightTable.reserve(airport->flightTable.size() + (size_t)(expected * 1.2) + 16);
+
+    long long serial = 0;
+    for (int minute = 0; minute < profile.minutes; minute++) {
+        double rate = profile.flightsPerMinute;
+        if (minute >= profile.surgeStart && minute < profile.surgeEnd) rate *= profile.surgeFactor;
+        int count = (rate > 0) ? std::poisson_distribution<int>(rate)(rng) : 0;
+
+        for (int k = 0; k < count; k++) {
+            Aircraft flight;
+
+            double pick = rng.uniform() * mixTotal;
+            flight.type = MEDICAL;
+            for (int t = 0; t < 4; t++) {
+                if (pick < profile.typeMix[t]) { flight.type = t; break; }
+                pick -= profile.typeMix[t];
+            }
+
+            bool isArrival = rng.uniform() < profile.arrivalShare;
+            flight.direction = isArrival ? rng.range(DIR_NORTH, DIR_SOUTH) : rng.range(DIR_EAST, DIR_WEST);
+
+            const AirlineCode &airline = airlinesByType[flight.type][rng.range(0, 1)];
+            snprintf(flight.flightName, sizeof(flight.flightName), "%s%lld", airline.code, ++serial);
+            strcpy(flight.airline, airline.name);
+            flight.airlinenumber = airline.number;
+
+            flight.scheduledTime = minute;
+            flight.priority = rng.range(profile.priorityMin, profile.priorityMax);
+            prepareFlight(flight, rng.uniform() < profile.emergencyRate);
+
+            if (isArrival)
+                airport->arrivalFlights.push_back(flight);
+            else
+                airport->departureFlights.push_back(flight);
+        }
+    }
 }
 
+// Record the runway on the flight; the arbiter has already claimed it for the flight
 void assignToRunway(Aircraft &flight, int runwayIndex) {
-    if (runways[runwayIndex].isAvailable) {
-        runways[runwayIndex].isAvailable = false;
-        strcpy(runways[runwayIndex].currentFlight, flight.flightName);
-        flight.isAssigned = true;
-        flight.assignedRunway = runwayIndex;
+    if (airport->runways[runwayIndex].occupant() == flight.id) {
+        airport->flightTable.beginWrite(flight.id);
+        airport->flightTable.isAssigned[flight.id] = 1;
+        airport->flightTable.assignedRunway[flight.id] = runwayIndex;
+        airport->flightTable.endWrite(flight.id);
+        journalEvent(JEV_ASSIGN, flight.id, runwayIndex, flight.waitingTime);
+        airport->runwayAssignments.add();
+        airport->runwayWait.record(flight.type, flight.isEmergency,
+                                   std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       airport->clock.now() - flight.phaseStartTime).count());
        /* sprintf(flight.status, "Assigned Runway %c", 'A' + runwayIndex);
         cout << "RUNWAY ASSIGNED: Flight " << flight.flightName 
              << " (Priority: " << flight.priority 
              << ", Type: " << getAircraftTypeName(flight.type)
-             << ") assigned to Runway " << (char)('A' + runwayIndex) << endl;*/
+             << ") assigned to Runway " << airport->runways[runwayIndex].name << endl;*/
     } else {
-        cout << "ERROR: Tried to assign already occupied Runway " 
-             << (char)('A' + runwayIndex) << " to flight " << flight.flightName << endl;
+        logger.log(LOG_ERROR, "ERROR: Tried to assign unclaimed Runway %s to flight %s",
+                   airport->runways[runwayIndex].name, flight.flightName);
     }
 }
 
 
-void monitorSpeed(Aircraft &flight) {
-    string flightID = flight.flightName;
-   PhaseData &data = flight.phaseData;
+void monitorSpeed(int id) {
+    int &speed = airport->flightTable.speed[id];
+    int8_t &phase = airport->flightTable.phase[id];
+   PhaseData &data = airport->flightTable.phaseData[id];
+    uint32_t tick = airport->flightTable.tick[id];
 
-    bool isArrival = (flight.direction == DIR_NORTH || flight.direction == DIR_SOUTH);
+    bool isArrival = airport->flightTable.isArrival(id);
 
     if (data.timer < 10) {
         // If threshold was already crossed, maintain the sustained speed
         if (data.thresholdCrossed) {
-            flight.speed = data.sustainedSpeed;
+            speed = data.sustainedSpeed;
               data.thresholdCrossed = false;
         } else {
                       int change=0;
             // Check threshold based on phase
             if (isArrival) {            
-                switch (flight.phase) {
+                switch (phase) {
                     case HOLDING:
-                      change = (rand() % 100)+1 ; 
-                     flight.speed -= change;
-              if (flight.speed < 0) flight.speed = 0; // Ensure speed doesn't go below 0
-                        if (flight.speed <= 400) {
+                      change = flightRandom(id, tick, RNG_SPEED, 100)+1 ; 
+                     speed -= change;
+              if (speed < 0) speed = 0; // Ensure speed doesn't go below 0
+                        if (speed <= 400) {
                             data.thresholdCrossed = true;
-                            data.sustainedSpeed = 500;//flight.speed;
+                            data.sustainedSpeed = 500;//speed;
                         }
                         break;
                     case APPROACH:
-                      change = (rand() % 5) +1; 
-                     flight.speed -= change;
-              if (flight.speed < 0) flight.speed = 0; // Ensure speed doesn't go below 0
-                        if (flight.speed <= 240) {
+                      change = flightRandom(id, tick, RNG_SPEED, 5) +1; 
+                     speed -= change;
+              if (speed < 0) speed = 0; // Ensure speed doesn't go below 0
+                        if (speed <= 240) {
                             data.thresholdCrossed = true;
-                            data.sustainedSpeed =270; //flight.speed;
+                            data.sustainedSpeed =270; //speed;
                         }
                         break;
                     case LANDING:
-                      change = (rand() % 30) +1; 
-                     flight.speed -= change;
-              if (flight.speed < 0) flight.speed = 0; // Ensure speed doesn't go below 0
-                        if (flight.speed <= 30) {
+                      change = flightRandom(id, tick, RNG_SPEED, 30) +1; 
+                     speed -= change;
+              if (speed < 0) speed = 0; // Ensure speed doesn't go below 0
+                        if (speed <= 30) {
                             data.thresholdCrossed = true;
-                            data.sustainedSpeed = 100;//flight.speed;
+                            data.sustainedSpeed = 100;//speed;
                         }
                         break;
                     case TAXI:
-                      change = (rand() % 2)+1; 
-                     flight.speed -= change;
-              if (flight.speed < 0) flight.speed = 0; // Ensure speed doesn't go below 0
-                        if (flight.speed <= 15) {
+                      change = flightRandom(id, tick, RNG_SPEED, 2)+1; 
+                     speed -= change;
+              if (speed < 0) speed = 0; // Ensure speed doesn't go below 0
+                        if (speed <= 15) {
                             data.thresholdCrossed = true;
-                            data.sustainedSpeed = 20;//flight.speed;
+                            data.sustainedSpeed = 20;//speed;
                         }
                         break;
                         
                         case AT_GATE:
-                      change = (rand() % 2) ; 
-                     flight.speed -= change;
-              if (flight.speed < 0) flight.speed = 0; // Ensure speed doesn't go below 0
-                        if (flight.speed <= 0) {
+                      change = flightRandom(id, tick, RNG_SPEED, 2) ; 
+                     speed -= change;
+              if (speed < 0) speed = 0; // Ensure speed doesn't go below 0
+                        if (speed <= 0) {
                             data.thresholdCrossed = true;
-                            data.sustainedSpeed = 3;//flight.speed;
+                            data.sustainedSpeed = 3;//speed;
                         }
                         break;
                     default: break;
                 }
             } else {
-                switch (flight.phase) {
+                switch (phase) {
                     case AT_GATE:
-                    change = (rand() % 2) ; 
-                     flight.speed += change;
-              if (flight.speed < 0) flight.speed = 0; // Ensure speed doesn't go below 0
-                        if (flight.speed >= 5) {
+                    change = flightRandom(id, tick, RNG_SPEED, 2) ; 
+                     speed += change;
+              if (speed < 0) speed = 0; // Ensure speed doesn't go below 0
+                        if (speed >= 5) {
                             data.thresholdCrossed = true;
-                            data.sustainedSpeed = 1;//flight.speed;
+                            data.sustainedSpeed = 1;//speed;
                         }
                         break;
                     case TAXI:
-                    change = (rand() %2 )+1 ; 
-                     flight.speed += change;
-              if (flight.speed < 0) flight.speed = 0; // Ensure speed doesn't go below 0
-                        if (flight.speed >= 30) {
+                    change = flightRandom(id, tick, RNG_SPEED, 2)+1 ; 
+                     speed += change;
+              if (speed < 0) speed = 0; // Ensure speed doesn't go below 0
+                        if (speed >= 30) {
                             data.thresholdCrossed = true;
-                            data.sustainedSpeed = 20;//flight.speed;
+                            data.sustainedSpeed = 20;//speed;
                         }
                         break;
                     case TAKEOFF_ROLL:
-                    change = (rand() % 30)+1 ; 
-                     flight.speed += change;
-              if (flight.speed < 0) flight.speed = 0; // Ensure speed doesn't go below 0
-                        if (flight.speed >= 290) {
+                    change = flightRandom(id, tick, RNG_SPEED, 30)+1 ; 
+                     speed += change;
+              if (speed < 0) speed = 0; // Ensure speed doesn't go below 0
+                        if (speed >= 290) {
                             data.thresholdCrossed = true;
-                            data.sustainedSpeed = 220;//flight.speed;
+                            data.sustainedSpeed = 220;//speed;
                         }
                         break;
                     case CLIMB:
-                    change = (rand() % 20)+1 ; 
-                     flight.speed += change;
-              if (flight.speed < 0) flight.speed = 0; // Ensure speed doesn't go below 0
-                        if (flight.speed >= 463) {
+                    change = flightRandom(id, tick, RNG_SPEED, 20)+1 ; 
+                     speed += change;
+              if (speed < 0) speed = 0; // Ensure speed doesn't go below 0
+                        if (speed >= 463) {
                             data.thresholdCrossed = true;
-                            data.sustainedSpeed = 400;//flight.speed;
+                            data.sustainedSpeed = 400;//speed;
                         }
                         break;
                         case DEPARTURE:
-                    change = (rand() % 10)+1 ; 
-                     flight.speed += change;
-              if (flight.speed < 0) flight.speed = 0; // Ensure speed doesn't go below 0
-                        if (flight.speed >= 900) {
+                    change = flightRandom(id, tick, RNG_SPEED, 10)+1 ; 
+                     speed += change;
+              if (speed < 0) speed = 0; // Ensure speed doesn't go below 0
+                        if (speed >= 900) {
                             data.thresholdCrossed = true;
-                            data.sustainedSpeed = 860;//flight.speed;
+                            data.sustainedSpeed = 860;//speed;
                         }
                         break;
                     default: break;
@@ -1098,39 +4064,25 @@ void monitorSpeed(Aircraft &flight) {
             }
         }
 
-        // Update flight status text (based on current phase)
-        switch (flight.phase) {
-            case HOLDING:    sprintf(flight.status, "Holding at %d km/h", flight.speed); break;
-            case APPROACH:   sprintf(flight.status, "Approaching at %d km/h", flight.speed); break;
-            case LANDING:    sprintf(flight.status, "Landing at %d km/h", flight.speed); break;
-            case TAXI:       sprintf(flight.status, "Taxiing at %d km/h", flight.speed); break;
-            case AT_GATE:    strcpy(flight.status, "At Gate"); break;
-            case TAKEOFF_ROLL: sprintf(flight.status, "Takeoff Roll at %d km/h", flight.speed); break;
-            case CLIMB:      sprintf(flight.status, "Climbing at %d km/h", flight.speed); break;
-            case DEPARTURE:  sprintf(flight.status, "Departing at %d km/h", flight.speed); break;
-            default: break;
-        }
-
         data.timer++;
     } else {
             if (isArrival) {
-                switch (flight.phase) {
-                    case HOLDING:    flight.phase = APPROACH; flight.speed = 290; break;
-                    case APPROACH:   flight.phase = LANDING;  flight.speed = 240;break;
-                    case LANDING:    flight.phase = TAXI;     flight.speed = 30; break;
-                    case TAXI:       flight.phase = AT_GATE;  flight.speed = 5; strcpy(flight.status, "At Gate"); break;
-                    case AT_GATE:    strcpy(flight.status, "Arrived"); flight.completed = true; break;
+                switch (phase) {
+                    case HOLDING:    phase = APPROACH; speed = 290; break;
+                    case APPROACH:   phase = LANDING;  speed = 240;break;
+                    case LANDING:    phase = TAXI;     speed = 30; break;
+                    case TAXI:       phase = AT_GATE;  speed = 5; break;
+                    case AT_GATE:    airport->flightTable.completed[id] = 1; break;
                     default: break;
             }
             } else {
-                switch (flight.phase) {
-                    case AT_GATE:    flight.phase = TAXI; flight.speed = 15; break;
-                    case TAXI:       flight.phase = TAKEOFF_ROLL; flight.speed = 50; break;
-                    case TAKEOFF_ROLL: flight.phase = CLIMB; flight.speed = 300;break;
-                    case CLIMB:      flight.phase = DEPARTURE; flight.speed = 800; break;
+                switch (phase) {
+                    case AT_GATE:    phase = TAXI; speed = 15; break;
+                    case TAXI:       phase = TAKEOFF_ROLL; speed = 50; break;
+                    case TAKEOFF_ROLL: phase = CLIMB; speed = 300;break;
+                    case CLIMB:      phase = DEPARTURE; speed = 800; break;
                     case DEPARTURE:
-                            strcpy(flight.status, "Departed");
-                            flight.completed = true;
+                            airport->flightTable.completed[id] = 1;
                             break;
                     default: break;
                 }
@@ -1144,34 +4096,76 @@ void monitorSpeed(Aircraft &flight) {
     }
 }
 
-void checkSpeedViolations(Aircraft &flight) {
-    if (flight.type == MILITARY || flight.type == MEDICAL) return;
+// Tracks violation episodes instead of fining every tick: an episode opens when
+// the speed leaves the phase's limits and is fined once when the speed is back in
+// range, the phase changes, or it has lasted VIOLATION_EPISODE_MAX_TICKS.
+void checkSpeedViolations(int id) {
+    int type = airport->flightTable.type[id];
+    if (type == MILITARY || type == MEDICAL) return;
 
-    int limitIndex = findSpeedLimit(flight.phase);
-    if (limitIndex == -1) return;
+    int phase = airport->flightTable.phase[id];
+    ViolationEpisode &episode = airport->flightTable.episode[id];
+    int limitIndex = findSpeedLimit(phase);
+    int speed = airport->flightTable.speed[id];
+    int permissible = 0;
+    if (limitIndex != -1) {
+        if (speed < speedLimits[limitIndex].minSpeed) permissible = speedLimits[limitIndex].minSpeed;
+        if (speed > speedLimits[limitIndex].maxSpeed) permissible = speedLimits[limitIndex].maxSpeed;
+    }
+    bool outside = limitIndex != -1 && (speed < speedLimits[limitIndex].minSpeed ||
+                                        speed > speedLimits[limitIndex].maxSpeed);
 
-    int minSpeed = speedLimits[limitIndex].minSpeed;
-    int maxSpeed = speedLimits[limitIndex].maxSpeed;
+    // The next phase has its own limits, so a phase change ends the episode
+    if (episode.open() && (!outside || episode.phase != phase))
+        closeViolationEpisode(id);
+    if (!outside) return;
 
-    if (flight.speed < minSpeed || flight.speed > maxSpeed) {
-        //if (!flight.hasSpeedViolation) {
-            generateAVN(flight, flight.speed, (flight.speed < minSpeed) ? minSpeed : maxSpeed);
-            flight.hasSpeedViolation = true;
-   //     }
+    if (!episode.open()) {
+        episode.phase = phase;
+        episode.ticks = 0;
+        episode.peakSpeed = speed;
+        episode.permissibleSpeed = permissible;
+        airport->flightTable.beginWrite(id);
+        airport->flightTable.hasSpeedViolation[id] = 1;
+        airport->flightTable.endWrite(id);
+        journalEvent(JEV_VIOLATION, id, phase, speed);
+    } else if (abs(speed - permissible) > abs(episode.peakSpeed - episode.permissibleSpeed)) {
+        episode.peakSpeed = speed;
+        episode.permissibleSpeed = permissible;
     }
+
+    if (++episode.ticks >= VIOLATION_EPISODE_MAX_TICKS)
+        closeViolationEpisode(id);
 }
 
-void generateAVN(const Aircraft &flight, int recordedSpeed, int permissibleSpeed) {
-    std::lock_guard<std::mutex> lock(avnMutex);
-    
-    AVN newAVN;
-    sprintf(newAVN.avnId, "AVN-%d", (int)aviationViolationNotices.size() + 1);
-    strncpy(newAVN.flightName, flight.flightName, 10);
-    strncpy(newAVN.airline, flight.airline, 30);
+// Issue the one AVN of an open episode; called by the flight's own tick
+void closeViolationEpisode(int id) {
+    ViolationEpisode &episode = airport->flightTable.episode[id];
+    if (!episode.open()) return;
+    generateAVN(*airport->flightTable.record[id], episode.peakSpeed, episode.permissibleSpeed);
+    episode = ViolationEpisode();
+}
+
+// The notice with the given sequence number; shared by generateAVN() and the replay
+void fillAVN(AVN &newAVN, const Aircraft &flight, int recordedSpeed, int permissibleSpeed,
+             int number, time_t issueTime) {
+    avnInit(newAVN, AVN_MSG_NOTICE);
+    // Ids carry the airport code in a multi-airport run, so they stay unique in the
+    // merged stream
+    if (airport->code[0])
+        snprintf(newAVN.avnId, sizeof(newAVN.avnId), "%s-AVN-%d", airport->code, number);
+    else
+        snprintf(newAVN.avnId, sizeof(newAVN.avnId), "AVN-%d", number);
+    newAVN.airportId = (uint16_t)airport->id;
+    // The record's name field is shorter than Aircraft's; StripePay keys fines by it
+    snprintf(newAVN.flightName, sizeof(newAVN.flightName), "%.*s",
+             (int)sizeof(newAVN.flightName) - 1, flight.flightName);
+    if (flight.isEmergency) newAVN.flags |= AVN_FLAG_EMERGENCY;
+    snprintf(newAVN.airline, sizeof(newAVN.airline), "%.*s", (int)sizeof(newAVN.airline) - 1, flight.airline);
     newAVN.aircraftType = flight.type;
     newAVN.recordedSpeed = recordedSpeed;
     newAVN.permissibleSpeed = permissibleSpeed;
-    newAVN.issueTime = time(NULL);
+    newAVN.issueTime = issueTime;
     newAVN.dueDate = newAVN.issueTime + (3 * 24 * 60 * 60);  // 3 days later
 
     switch (flight.type) {
@@ -1184,114 +4178,123 @@ void generateAVN(const Aircraft &flight, int recordedSpeed, int permissibleSpeed
         newAVN.fineAmount *= 1.15;
 
     newAVN.isPaid = false;
-    aviationViolationNotices.push_back(newAVN);
-
-    cout << "!!! AVN ISSUED for " << flight.flightName << " Speed Violation!" << endl;
-    // Serialize AVN to string
-    char buffer[512];
-    snprintf(buffer, sizeof(buffer), "%s|%s|%s|%d|%d|%d|%ld|%.2f|%d\n",
-        newAVN.avnId,
-        newAVN.flightName,
-        newAVN.airline,
-        newAVN.aircraftType,
-        newAVN.recordedSpeed,
-        newAVN.permissibleSpeed,
-        newAVN.issueTime,
-        newAVN.fineAmount,
-        newAVN.isPaid ? 1 : 0
-    );
-
-    // Write to pipe
-    int fd = open(ATC_TO_AVN_PIPE, O_WRONLY | O_NONBLOCK);
-    if (fd != -1) {
-        write(fd, buffer, strlen(buffer));
-        close(fd);
-    } else {
-        cerr << "Could not open pipe for writing: " << strerror(errno) << endl;
-    }
+    newAVN.generatedNs = avnClockNs();
+}
+
+void generateAVN(const Aircraft &flight, int recordedSpeed, int permissibleSpeed) {
+    std::unique_lock<std::mutex> lock(airport->avnMutex);
+    AVN newAVN;
+    fillAVN(newAVN, flight, recordedSpeed, permissibleSpeed,
+            (int)airport->aviationViolationNotices.size() + 1, airport->clock.wallTime());
+    airport->aviationViolationNotices.push_back(newAVN);
+    journalEvent(JEV_AVN, flight.id, 0, recordedSpeed, permissibleSpeed);
+    lock.unlock();
+    airport->avnsIssued.add();
+
+    logger.log(LOG_INFO, "!!! AVN ISSUED for %s Speed Violation!", flight.flightName);
+    // Hand over to the emitter thread; no pipe syscall on the flight thread
+    avnEmitter.push(&newAVN, sizeof(newAVN));
 }
 
 void handleGroundFault(Aircraft &flight) {
-    cout << "!!! GROUND FAULT detected for " << flight.flightName << " - removing from system" << endl;
+    logger.log(LOG_WARN, "!!! GROUND FAULT detected for %s - removing from system", flight.flightName);
+    airport->groundFaultCount++;
+    journalEvent(JEV_GROUND_FAULT, flight.id);
     
     {
-        std::lock_guard<std::mutex> lock(activeMutex);
+        std::lock_guard<std::mutex> lock(airport->activeMutex);
         
-        int index = findFlightIndex(flight.flightName);
-        if (index != -1) {
+        if (airport->activeFlights.contains(flight.id)) {
             // Free the runway if this aircraft was using one
-            freeRunway(flight.flightName);
+            freeRunway(flight.id);
             
             // Remove from active flights
-            activeFlights.erase(activeFlights.begin() + index);
+            airport->activeFlights.erase(flight.id);
         }
     }
 }
 
+// Flight id for a name, or -1 if no such flight was scheduled
+int findFlightId(const char* flightName) {
+    auto it = airport->flightIdByName.find(flightName);
+    return (it != airport->flightIdByName.end()) ? it->second : -1;
+}
+
+// Slot of a flight in activeFlights, or -1 if it is not active
 int findFlightIndex(const char* flightName) {
-    for (int i = 0; i < activeFlights.size(); i++) {
-        if (strcmp(activeFlights[i]->flightName, flightName) == 0) {
-            return i;
-        }
-    }
-    return -1;
+    return airport->activeFlights.slotOf(findFlightId(flightName));
 }
 
+// Built in a buffer and written in one go, so the block is not interleaved with
+// the logger's output
 void displayDashboard(int currentTime) {
+    if (cout.fail()) return;  // --quiet
+    std::ostringstream out;
+
     // clearScreen();
-    cout << "================= AirControlX Dashboard =================\n";
-    cout << "Current Time: " << currentTime << " minutes\n\n";
+    out << "================= AirControlX Dashboard =================\n";
+    if (airport->code[0]) out << "Airport: " << airport->code << "\n";
+    out << "Current Time: " << currentTime << " minutes\n\n";
 
-    cout << "Active Flights:\n";
-    for (auto flight : activeFlights) {
-        cout << "- " << flight->flightName << " | " << flight->airline
+    out << "Active Flights:\n";
+    char status[50];
+    for (auto flight : airport->activeFlights.items()) {
+        out << "- " << flight->flightName << " | " << flight->airline
              << " | Type: " << getAircraftTypeName(flight->type)
              << " | Dir: " << getDirectionName(flight->direction)
-             << " | Status: " << flight->status
-             << " | Phase: " << getPhaseName(flight->phase)
-             << " | Speed: " << flight->speed << " km/h"
-             << " | Wait: " << flight->waitingTime << " min"
+             << " | Status: " << describeStatus(flight->id, status, sizeof(status))
+             << " | Phase: " << getPhaseName(airport->flightTable.phase[flight->id])
+             << " | Speed: " << airport->flightTable.speed[flight->id] << " km/h"
+             << " | Wait: " << (airport->flightTable.isAssigned[flight->id] ? flight->waitingTime
+                                  : (int)std::chrono::duration_cast<std::chrono::seconds>(
+                                        airport->clock.now() - flight->waitStartTime).count()) << " min"
              << " | Priority: " << flight->priority;
         
-        if (flight->hasSpeedViolation)
-            cout << " [SPEED VIOLATION]";
+        if (airport->flightTable.hasSpeedViolation[flight->id])
+            out << " [SPEED VIOLATION]";
             
-        cout << "\n";
+        out << "\n";
     }
 
-    cout << "\nRunway Status:\n";
-    for (int i = 0; i < 3; i++) {
-        const char* rwyName = (i == 0) ? "RWY-A" : (i == 1) ? "RWY-B" : "RWY-C";
-        cout << "- " << rwyName << ": " << (runways[i].isAvailable ? "Available" : runways[i].currentFlight) << "\n";
+    out << "\nRunway Status:\n";
+    for (int i = 0; i < airport->runwayCount; i++) {
+        int occupant = airport->runways[i].occupant();
+        out << "- RWY-" << airport->runways[i].name << ": " << (occupant < 0 ? "Available" : airport->flightTable.record[occupant]->flightName) << "\n";
     }
 
-    if (!aviationViolationNotices.empty()) {
-        cout << "\nAviation Violation Notices (" << aviationViolationNotices.size() << "):\n";
-        int displayCount = min(5, (int)aviationViolationNotices.size()); // Show only latest 5 AVNs
-        for (int i = aviationViolationNotices.size() - 1; i >= (int)aviationViolationNotices.size() - displayCount; i--) {
-            AVN &avn = aviationViolationNotices[i];
-            cout << "- " << avn.avnId << " | " << avn.flightName 
+    if (!airport->aviationViolationNotices.empty()) {
+        out << "\nAviation Violation Notices (" << airport->aviationViolationNotices.size() << "):\n";
+        int displayCount = min(5, (int)airport->aviationViolationNotices.size()); // Show only latest 5 AVNs
+        for (int i = airport->aviationViolationNotices.size() - 1; i >= (int)airport->aviationViolationNotices.size() - displayCount; i--) {
+            AVN &avn = airport->aviationViolationNotices[i];
+            out << "- " << avn.avnId << " | " << avn.flightName 
                  << " | Speed: " << avn.recordedSpeed << "/" << avn.permissibleSpeed << " km/h"
                  << " | Fine: PKR " << avn.fineAmount << "\n";
         }
     }
 
-    cout << "========================================================\n\n";
+    out << "========================================================\n\n";
+    cout << out.str() << flush;
 }
 
-void freeRunway(const char* flightName) {
-    std::lock_guard<std::mutex> lock(runwayMutex);
-    
-    for (int i = 0; i < 3; i++) {
-        if (strcmp(runways[i].currentFlight, flightName) == 0) {
-            runways[i].isAvailable = true;
-            strcpy(runways[i].currentFlight, "");
-            cout << "RUNWAY FREED: Runway " << (char)('A' + i) << " is now available" << endl;
-            
-            // Notify waiting threads that a runway is available
-            runwayCV.notify_all();
-            break;
-        }
+void freeRunway(int flightId) {
+    Aircraft *next = nullptr;
+    auto releasedAt = RunwayArbiter::Clock::now();
+
+    // The flight records its runway, so no search over the runways is needed, and
+    // only that runway's lock is taken
+    int i = airport->flightTable.assignedRunway[flightId];
+    if (i >= 0 && airport->runways[i].occupant() == flightId) {
+        std::lock_guard<std::mutex> lock(airport->runways[i].waitMutex);
+        logger.log(LOG_INFO, "RUNWAY FREED: Runway %s is now available", airport->runways[i].name);
+        journalEvent(JEV_RELEASE, flightId, i);
+
+        // Hand the runway directly to the best flight queued for it
+        next = airport->runwayArbiter->handOff(i);
+    }
+
+    if (next && airport->runwayArbiter->onGrant) {
+        airport->runwayArbiter->onGrant(next, releasedAt);
     }
 }
 
@@ -1329,6 +4332,31 @@ const char* getAircraftTypeName(int type) {
     }
 }
 
+// Status line of a flight, derived from its phase and speed when displayed
+const char* describeStatus(int id, char* buffer, size_t size) {
+    int speed = airport->flightTable.speed[id];
+    if (airport->flightTable.completed[id]) {
+        snprintf(buffer, size, "%s", airport->flightTable.isArrival(id) ? "Arrived" : "Departed");
+        return buffer;
+    }
+    if (!airport->flightTable.isAssigned[id]) {
+        snprintf(buffer, size, "Waiting");
+        return buffer;
+    }
+    switch (airport->flightTable.phase[id]) {
+        case HOLDING:    snprintf(buffer, size, "Holding at %d km/h", speed); break;
+        case APPROACH:   snprintf(buffer, size, "Approaching at %d km/h", speed); break;
+        case LANDING:    snprintf(buffer, size, "Landing at %d km/h", speed); break;
+        case TAXI:       snprintf(buffer, size, "Taxiing at %d km/h", speed); break;
+        case AT_GATE:    snprintf(buffer, size, "At Gate"); break;
+        case TAKEOFF_ROLL: snprintf(buffer, size, "Takeoff Roll at %d km/h", speed); break;
+        case CLIMB:      snprintf(buffer, size, "Climbing at %d km/h", speed); break;
+        case DEPARTURE:  snprintf(buffer, size, "Departing at %d km/h", speed); break;
+        default:         snprintf(buffer, size, "Unknown"); break;
+    }
+    return buffer;
+}
+
 int findSpeedLimit(int phase) {
     for (int i = 0; i < MAX_PHASES; i++) {
         if (speedLimits[i].phase == phase) {
@@ -1338,125 +4366,229 @@ int findSpeedLimit(int phase) {
     return -1;
 }
 
-void flightLifecycle(Aircraft *flight) {
-    //cout << "Thread started for flight " << flight->flightName << " with priority " << flight->priority << endl;
-    // Try to obtain a runway with proper priority handling
-    while (!flight->isAssigned && !flight->completed) {
-        // Try to get a runway immediately
-        {
-            std::unique_lock<std::mutex> lock(runwayMutex);
-        //    cout << "Flight " << flight->flightName << " trying to get runway" << endl;
-            
-            // Directly try to assign runway - simplified approach
-            bool assigned = false;
-            
-            // For cargo flights, only try Runway C
-            if (flight->type == CARGO) {
-                if (runways[RWY_C].isAvailable) {
-                    assignToRunway(*flight, RWY_C);
-                    assigned = true;
-                }
-            } 
-            // For emergency flights, try any runway
-            else if (flight->isEmergency || flight->type == MILITARY || flight->type == MEDICAL) {
-             //cout<<"emer "<<flight->isEmergency<<endl;
-           //  cout<<flight->type<<endl;
-           //  cout<<flight->isEmergency<<endl;
-                // Emergency arrival
-                if (flight->direction == DIR_NORTH || flight->direction == DIR_SOUTH) {
-                    if (runways[RWY_A].isAvailable) {
-                                    cout<<"assigning"<<flight->flightName<<"runway a emergency "<<endl;
-                        assignToRunway(*flight, RWY_A);
-                        assigned = true;
-                    } else if (runways[RWY_C].isAvailable) {
-                        assignToRunway(*flight, RWY_C);
-                        assigned = true;
-                    } else if (runways[RWY_B].isAvailable) {
-                        assignToRunway(*flight, RWY_B);
-                        assigned = true;
-                    }
-                } else { // Emergency departure
-                    if (runways[RWY_B].isAvailable) {
-                        assignToRunway(*flight, RWY_B);
-                        assigned = true;
-                    } else if (runways[RWY_C].isAvailable) {
-                        assignToRunway(*flight, RWY_C);
-                        assigned = true;
-                    } else if (runways[RWY_A].isAvailable) {
-                        assignToRunway(*flight, RWY_A);
-                        assigned = true;
-                    }
-                }
-            }
-            // For arrival flights (North/South), prefer Runway A
-            else if (flight->direction == DIR_NORTH || flight->direction == DIR_SOUTH) {
-                if (runways[RWY_A].isAvailable) {
-                cout<<"assigning"<<flight->flightName<<"runway a"<<endl;
-                    assignToRunway(*flight, RWY_A);
-                    assigned = true;
-                } else if (runways[RWY_C].isAvailable) {
-                  cout<<"assigning"<<flight->flightName<<"runway c bcz runway a not avaiilabe"<<endl;
-                    assignToRunway(*flight, RWY_C);
-                    assigned = true;
-                }
-            }
-            // For departure flights (East/West), prefer Runway B
-            else {
-                if (runways[RWY_B].isAvailable) {
-                                cout<<"assigning"<<flight->flightName<<"runway b"<<endl;
-                    assignToRunway(*flight, RWY_B);
-                    assigned = true;
-                } else if (runways[RWY_C].isAvailable) {
-                                  cout<<"assigning"<<flight->flightName<<"runway a bcz runway c not avaiilabe"<<endl;
-                    assignToRunway(*flight, RWY_C);
-                    assigned = true;
-                }
-            }
-            
-            if (assigned) {
-                cout << "SUCCESS: Flight " << flight->flightName << " (priority " << flight->priority 
-                     << ") assigned to runway " << (char)('A' + flight->assignedRunway) << endl;
-            } else {
-               auto now = std::chrono::steady_clock::now();
-flight->waitingTime = std::chrono::duration_cast<std::chrono::seconds>(now - flight->waitStartTime).count();
+// Runways a flight may use, in order of preference
+// The classic three-runway field: A for arrivals, B for departures, C for cargo
+// and as the overflow runway of both
+vector<RunwaySpec> defaultRunwayTopology() {
+    return {{"A", OP_ARRIVAL}, {"B", OP_DEPARTURE}, {"C", OP_CARGO | OP_OVERFLOW}};
+}
 
-             //   cout << "Flight " << flight->flightName << " waiting for runway, time: " << flight->waitingTime << endl;
-                }
+// Runway topology file, one runway per line in preference order:
+//   name,operation|operation...
+// with operations arrival, departure, cargo and overflow. Blank lines and '#'
+// comments are skipped.
+bool loadRunwayTopology(const char* path, vector<RunwaySpec> &specs) {
+    FILE* in = fopen(path, "r");
+    if (!in) {
+        cerr << "Could not open runway topology " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    specs.clear();
+    char line[256];
+    int lineNo = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), in)) {
+        lineNo++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        char* save = NULL;
+        char* name = strtok_r(line, ",", &save);
+        char* ops = strtok_r(NULL, ",", &save);
+        RunwaySpec spec = {"", 0};
+        if (name && ops && strlen(name) < sizeof(spec.name)) {
+            strcpy(spec.name, name);
+            for (char* op = strtok_r(ops, "|", &save); op; op = strtok_r(NULL, "|", &save)) {
+                if (strcmp(op, "arrival") == 0) spec.ops |= OP_ARRIVAL;
+                else if (strcmp(op, "departure") == 0) spec.ops |= OP_DEPARTURE;
+                else if (strcmp(op, "cargo") == 0) spec.ops |= OP_CARGO;
+                else if (strcmp(op, "overflow") == 0) spec.ops |= OP_OVERFLOW;
+                else spec.ops = -1;
             }
-      //      std::cout << "[WAITING] " << flight->flightName << " isAssigned=" << flight->isAssigned 
-         // << " completed=" << flight->completed << std::endl;
+        }
+        if (spec.ops <= 0) {
+            cerr << "Runway topology " << path << " line " << lineNo << ": invalid runway" << endl;
+            ok = false;
+        } else {
+            specs.push_back(spec);
+        }
+    }
+    fclose(in);
+    return ok;
+}
 
+// Airport network file, one airport per line:
+//   code[,scenario file[,runway topology file]]
+// An empty scenario or topology falls back to --scenario/--generate and --runways.
+// Blank lines and '#' comments are skipped.
+bool loadAirportNetwork(const char* path, vector<AirportSpec> &specs) {
+    FILE* in = fopen(path, "r");
+    if (!in) {
+        cerr << "Could not open airport network " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    specs.clear();
+    char line[600];
+    int lineNo = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), in)) {
+        lineNo++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        // strsep keeps empty fields, so "KHI,,runways.txt" has no scenario
+        char* cursor = line;
+        char* code = strsep(&cursor, ",");
+        char* scenario = cursor ? strsep(&cursor, ",") : NULL;
+        char* topology = cursor ? strsep(&cursor, ",") : NULL;
+        AirportSpec spec = {"", "", ""};
+        if (code[0] == '\0' || strlen(code) >= sizeof(spec.code) || cursor ||
+            (scenario && strlen(scenario) >= sizeof(spec.scenario)) ||
+            (topology && strlen(topology) >= sizeof(spec.runways))) {
+            cerr << "Airport network " << path << " line " << lineNo << ": invalid airport" << endl;
+            ok = false;
+            continue;
         }
-        
-        // If not assigned, wait a bit before trying again
-        // Use std::this_thread::sleep_for instead of sleep() for better cross-platform support
-        if (!flight->isAssigned) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(500)); // Wait 500ms before trying again
+        strcpy(spec.code, code);
+        if (scenario) strcpy(spec.scenario, scenario);
+        if (topology) strcpy(spec.runways, topology);
+        for (const AirportSpec &other : specs) {
+            if (strcmp(other.code, spec.code) == 0) {
+                cerr << "Airport network " << path << " line " << lineNo << ": duplicate airport " << code << endl;
+                ok = false;
+            }
         }
-    
-          // Process the flight after getting a runway
-    while (!flight->completed) {
-        if (flight->isAssigned) {
-            monitorSpeed(*flight);
-            checkSpeedViolations(*flight);
-
-            if (rand() % 100 == 0 && (flight->phase == TAXI || flight->phase == AT_GATE)) {
-                handleGroundFault(*flight);
-                break; // Exit if removed
+        specs.push_back(spec);
+    }
+    fclose(in);
+    if (ok && specs.empty()) {
+        cerr << "Airport network " << path << " lists no airports" << endl;
+        ok = false;
+    }
+    return ok;
+}
+
+// Runways of the topology that accept any of ops, in preference order, skipping
+// those already in the list
+static void appendRunways(vector<int> &order, int ops) {
+    for (int i = 0; i < airport->runwayCount; i++) {
+        if ((airport->runways[i].ops & ops) && std::find(order.begin(), order.end(), i) == order.end())
+            order.push_back(i);
+    }
+}
+
+// Build the runways and the candidate list of every (direction, type, emergency)
+// class. Must run before the simulation is created.
+bool configureRunways(const vector<RunwaySpec> &specs) {
+    airport->runwayCount = (int)specs.size();
+    airport->runways.reset(new Runway[airport->runwayCount]);
+    for (int i = 0; i < airport->runwayCount; i++) {
+        strcpy(airport->runways[i].name, specs[i].name);
+        airport->runways[i].ops = specs[i].ops;
+    }
+    airport->runwayArbiter.reset(new RunwayArbiter());
+    airport->runwayArbiter->configure(airport->runwayCount);
+
+    for (int dir = 0; dir < 4; dir++) {
+        bool isArrival = (dir == DIR_NORTH || dir == DIR_SOUTH);
+        for (int type = 0; type < 4; type++) {
+            for (int emergency = 0; emergency < 2; emergency++) {
+                RunwayClass &cls = airport->runwayClasses[dir][type][emergency];
+                cls.order.clear();
+                if (type == CARGO) {
+                    // Cargo flights only use cargo runways
+                    appendRunways(cls.order, OP_CARGO);
+                } else {
+                    // Own direction's runways first, then overflow; emergencies may
+                    // fall back to any runway
+                    appendRunways(cls.order, isArrival ? OP_ARRIVAL : OP_DEPARTURE);
+                    appendRunways(cls.order, OP_OVERFLOW);
+                    if (emergency || type == MILITARY || type == MEDICAL)
+                        appendRunways(cls.order, OP_ARRIVAL | OP_DEPARTURE | OP_CARGO | OP_OVERFLOW);
+                }
+                if (cls.order.empty()) {
+                    cerr << "Runway topology has no runway for " << getAircraftTypeName(type)
+                         << (isArrival ? " arrivals" : " departures") << endl;
+                    return false;
+                }
+                cls.lockOrder = cls.order;
+                std::sort(cls.lockOrder.begin(), cls.lockOrder.end());
             }
-        }   
-        // Sleep for shorter time to be more responsive
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    //    std::cout << "[PROCESSING] " << flight->flightName 
-   //       << " Phase=" << flight->phase 
-    //      << " completed=" << flight->completed << std::endl;
+        }
+    }
+    return true;
+}
+
+const char* runwayName(int runwayIndex) {
+    return (runwayIndex >= 0 && runwayIndex < airport->runwayCount) ? airport->runways[runwayIndex].name : "-";
+}
+
+// Candidate runways for a flight, in preference order
+const RunwayClass& runwayCandidates(const Aircraft *flight) {
+    return airport->runwayClasses[flight->direction][flight->type][flight->isEmergency ? 1 : 0];
+}
 
+// One tick of a flight's life: get a runway, then monitor speed phase by phase.
+// Returns the delay in ms until the next tick, or -1 once the flight is done.
+int flightLifecycle(Aircraft *flight) {
+    // Not assigned yet: wait at the arbiter until a runway is handed over
+    int id = flight->id;
+    if (!airport->flightTable.isAssigned[id] && !airport->flightTable.completed[id]) {
+        if (!airport->runwayArbiter->request(flight)) {
+            return FlightWorkerPool::TASK_PARKED;
         }
-         freeRunway(flight->flightName);
-    //     std::cout << "Flight thread finished: " << flight->flightName << std::endl;
+    }
+
+    // Completed during the previous tick: release the runway
+    if (airport->flightTable.completed[id]) {
+        closeViolationEpisode(id);
+        freeRunway(id);
+        return -1;
+    }
+
+    if (!advanceFlight(flight)) {
+        closeViolationEpisode(id);
+        freeRunway(id);
+        return -1; // Exit if removed
+    }
+
+    return FLIGHT_TICK_MS;
 }
-    
-    
+
+// Speed monitoring, violation check and ground-fault roll for one tick of an
+// assigned flight. Returns false if a ground fault removed the flight.
+bool advanceFlight(Aircraft *flight) {
+    int id = flight->id;
+    int phaseBefore = airport->flightTable.phase[id];
+    airport->flightTable.beginWrite(id);
+    monitorSpeed(id);
+    airport->flightTable.endWrite(id);
+    if (airport->flightTable.completed[id]) airport->flightsCompleted.add();
+    // Journaled after the write section, so the snapshot reader never waits on it
+    if (airport->journal) {
+        int phaseAfter = airport->flightTable.phase[id];
+        if (airport->flightTable.completed[id])
+            journalEvent(JEV_COMPLETE, id, phaseAfter);
+        else
+            journalEvent(phaseAfter != phaseBefore ? JEV_PHASE : JEV_SPEED, id, phaseAfter,
+                         airport->flightTable.speed[id]);
+    }
+    checkSpeedViolations(id);
+
+    int phase = airport->flightTable.phase[id];
+    // Rolled every tick so the draws stay aligned; a flight that completed this
+    // tick is done and cannot fault as well
+    bool fault = flightRandom(id, airport->flightTable.tick[id]++, RNG_GROUND_FAULT, 100) == 0;
+    if (fault && !airport->flightTable.completed[id] && (phase == TAXI || phase == AT_GATE)) {
+        handleGroundFault(*flight);
+        return false;
+    }
+    return true;
+}
+
+
 
 void clearScreen() {
     cout << "\033[2J\033[1;1H";
@@ -11,6 +11,9 @@
 #include <map>
 #include <ctime>
 #include <atomic>  // ✅ Added for atomic flag
+#include "avn_protocol.h"
+#include "latency_histogram.h"
+#include "metrics.h"
 
 using namespace std;
 
@@ -22,18 +25,15 @@ std::mutex avnMutex;
 
 std::atomic<bool> running(true);
 
-// Structure for AVN
-struct AVN {
-    char avnId[20];
-    char flightName[30];
-    char airline[30];
-    int aircraftType;
-    int recordedSpeed;
-    int permissibleSpeed;
-    time_t issueTime;
-    double fineAmount;
-    bool isPaid;
-};
+// AVNs travel as the shared binary record, see avn_protocol.h
+typedef AvnRecord AVN;
+
+// Time from generateAVN() in the controller until a new notice arrives here
+LatencyBreakdown receiptLatency;
+
+// Counters and gauges written to METRICS_DIR/portal.prom, see metrics.h
+MetricsRegistry metrics;
+PipeMetrics fromAVN;
 
 // Map to store AVNs by airline
 std::map<std::string, std::vector<AVN>> airlineAVNs;
@@ -46,46 +46,6 @@ void createPipeIfNotExist() {
     }
 }
 
-// Parse AVN from buffer
-AVN parseAVN(const char* buffer) {
-    AVN newAVN;
-    memset(&newAVN, 0, sizeof(AVN));
-    
-    // Create a copy of the buffer to tokenize
-    char bufferCopy[1024];
-    strncpy(bufferCopy, buffer, sizeof(bufferCopy) - 1);
-    bufferCopy[sizeof(bufferCopy) - 1] = '\0';
-    
-    char* token = strtok(bufferCopy, "|");
-    if (token) strncpy(newAVN.avnId, token, sizeof(newAVN.avnId) - 1);
-    
-    token = strtok(NULL, "|");
-    if (token) strncpy(newAVN.flightName, token, sizeof(newAVN.flightName) - 1);
-    
-    token = strtok(NULL, "|");
-    if (token) strncpy(newAVN.airline, token, sizeof(newAVN.airline) - 1);
-    
-    token = strtok(NULL, "|");
-    if (token) newAVN.aircraftType = atoi(token);
-    
-    token = strtok(NULL, "|");
-    if (token) newAVN.recordedSpeed = atoi(token);
-    
-    token = strtok(NULL, "|");
-    if (token) newAVN.permissibleSpeed = atoi(token);
-    
-    token = strtok(NULL, "|");
-    if (token) newAVN.issueTime = atol(token);
-    
-    token = strtok(NULL, "|");
-    if (token) newAVN.fineAmount = atof(token);
-    
-    token = strtok(NULL, "|");
-    if (token) newAVN.isPaid = atoi(token) == 1;
-    
-    return newAVN;
-}
-
 // Format date and time
 std::string formatTime(time_t timestamp) {
     struct tm* timeinfo = localtime(&timestamp);
@@ -113,19 +73,29 @@ void listenForAVNs() {
         return;
     }
     
-    char buffer[1024];
+    AVN records[8];
+    AvnStreamReader reader;
     while (running) {
-        ssize_t bytesRead = read(fd, buffer, sizeof(buffer) - 1);
-        if (bytesRead > 0) {
-            buffer[bytesRead] = '\0';
-            if (strncmp(buffer, "EXIT", 4) == 0) {
+        int count = reader.readFrom(fd, records, 8);
+        if (count < 0) {
+            usleep(100000); // No writer yet
+            continue;
+        }
+        int64_t receivedNs = avnClockNs();
+        fromAVN.add(count, sizeof(AVN));
+        for (int i = 0; i < count && running; i++) {
+            const AVN &receivedAVN = records[i];
+            if (!avnValid(receivedAVN)) continue;
+            if (receivedAVN.messageType == AVN_MSG_EXIT) {
                 cout << "Received exit signal. Shutting down..." << endl;
                                 running = false;  // ✅ Stop the program
 
                 break;
             }
-            // Parse the AVN
-            AVN receivedAVN = parseAVN(buffer);
+            // Payment updates are re-sends of an old notice; only first arrivals count
+            if (!receivedAVN.isPaid)
+                receiptLatency.record(receivedAVN.aircraftType, receivedAVN.flags & AVN_FLAG_EMERGENCY,
+                                      receivedNs - receivedAVN.generatedNs);
             
             // Update in the map with mutex protection
             {
@@ -234,6 +204,28 @@ int main() {
     createPipeIfNotExist();
     
     cout << "Airline Portal Started" << endl;
+    LatencyReporter latency("portal");
+    latency.add("avn_portal_receipt", "", &receiptLatency);
+    latency.start();
+    fromAVN.registerAs(metrics, "portal", "avn_to_portal", false);
+    metrics.gauge("portal_airlines", "Airlines with at least one violation notice", "", []() {
+        std::lock_guard<std::mutex> lock(avnMutex);
+        return (double)airlineAVNs.size();
+    });
+    metrics.gauge("portal_avns", "Violation notices shown on the portal", "", []() {
+        std::lock_guard<std::mutex> lock(avnMutex);
+        size_t total = 0;
+        for (const auto &entry : airlineAVNs) total += entry.second.size();
+        return (double)total;
+    });
+    metrics.gauge("portal_avns_paid", "Violation notices shown as paid", "", []() {
+        std::lock_guard<std::mutex> lock(avnMutex);
+        size_t paid = 0;
+        for (const auto &entry : airlineAVNs)
+            for (const AVN &avn : entry.second) paid += avn.isPaid != 0;
+        return (double)paid;
+    });
+    metrics.startExport("portal");
     
     // Start threads
     std::thread avnListenerThread(listenForAVNs);
@@ -242,6 +234,8 @@ int main() {
     // Wait for threads to finish
     avnListenerThread.join();
     dashboardThread.join();
+    latency.stop();
+    metrics.stopExport();
     
       unlink(AVN_TO_PORTAL_PIPE);
     cout << "Airline Portal terminated cleanly." << endl;
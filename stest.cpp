@@ -10,6 +10,9 @@
 #include <thread>
 #include <map>
 #include <atomic>
+#include "avn_protocol.h"
+#include "latency_histogram.h"
+#include "metrics.h"
 
 using namespace std;
 
@@ -24,18 +27,16 @@ std::mutex dataMutex;
 // Atomic flag for thread control
 std::atomic<bool> running(true);
 
-// Structure for AVN
-struct AVN {
-    char avnId[20];
-    char flightName[30];
-    char airline[30];
-    int aircraftType;
-    int recordedSpeed;
-    int permissibleSpeed;
-    time_t issueTime;
-    double fineAmount;
-    bool isPaid;
-};
+// AVNs travel as the shared binary record, see avn_protocol.h
+typedef AvnRecord AVN;
+
+// Time from generateAVN() in the controller until a new notice arrives here
+LatencyBreakdown receiptLatency;
+
+// Counters and gauges written to METRICS_DIR/stripepay.prom, see metrics.h
+MetricsRegistry metrics;
+PipeMetrics fromAVN, toAVN, toPortal;
+MetricCounter paymentsMade;
 
 // Map to store AVNs by flight name
 std::map<std::string, AVN> avnMap;
@@ -60,78 +61,19 @@ void createPipesIfNotExist() {
     cout << "All pipes created successfully" << endl;
 }
 
-// Parse AVN from buffer
-AVN parseAVN(const char* buffer) {
-    AVN newAVN;
-    memset(&newAVN, 0, sizeof(AVN));
-
-    char bufferCopy[512];
-    strncpy(bufferCopy, buffer, sizeof(bufferCopy));
-    bufferCopy[sizeof(bufferCopy) - 1] = '\0';
-
-    char* token = strtok(bufferCopy, "|");
-    if (token) strncpy(newAVN.avnId, token, sizeof(newAVN.avnId) - 1);
-
-    token = strtok(NULL, "|");
-    if (token) strncpy(newAVN.flightName, token, sizeof(newAVN.flightName) - 1);
-
-    token = strtok(NULL, "|");
-    if (token) strncpy(newAVN.airline, token, sizeof(newAVN.airline) - 1);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.aircraftType = atoi(token);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.recordedSpeed = atoi(token);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.permissibleSpeed = atoi(token);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.issueTime = atol(token);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.fineAmount = atof(token);
-
-    token = strtok(NULL, "|");
-    if (token) newAVN.isPaid = atoi(token) == 1;
-
-    return newAVN;
-}
-
-// Serialize AVN to string
-void serializeAVN(const AVN& avn, char* buffer, size_t size) {
-    snprintf(buffer, size, "%s|%s|%s|%d|%d|%d|%ld|%.2f|%d\n",
-        avn.avnId,
-        avn.flightName,
-        avn.airline,
-        avn.aircraftType,
-        avn.recordedSpeed,
-        avn.permissibleSpeed,
-        avn.issueTime,
-        avn.fineAmount,
-        avn.isPaid ? 1 : 0
-    );
-}
-
 // Send payment status to AVN and Portal
 void sendPaymentStatus(const AVN& avn) {
-    char buffer[512];
-    serializeAVN(avn, buffer, sizeof(buffer));
-
     // Send to AVN
     int fd_avn = open(STRIPE_TO_AVN_PIPE, O_WRONLY | O_NONBLOCK);
-    if (fd_avn != -1) {
-        write(fd_avn, buffer, strlen(buffer));
-        close(fd_avn);
-    }
+    if (fd_avn != -1 && avnWrite(fd_avn, avn)) toAVN.add(1, sizeof(AVN));
+    else toAVN.failures.add();
+    if (fd_avn != -1) close(fd_avn);
 
     // Send to Portal
     int fd_portal = open(STRIPE_TO_PORTAL_PIPE, O_WRONLY | O_NONBLOCK);
-    if (fd_portal != -1) {
-        write(fd_portal, buffer, strlen(buffer));
-        close(fd_portal);
-    }
+    if (fd_portal != -1 && avnWrite(fd_portal, avn)) toPortal.add(1, sizeof(AVN));
+    else toPortal.failures.add();
+    if (fd_portal != -1) close(fd_portal);
 }
 
 // Listen for AVNs from AVN Generator
@@ -142,21 +84,31 @@ void listenForAVNs() {
         return;
     }
 
-    char buffer[1024];
+    AVN records[8];
+    AvnStreamReader reader;
     while (running) {
-        ssize_t bytesRead = read(fd, buffer, sizeof(buffer) - 1);
-        if (bytesRead > 0) {
-            buffer[bytesRead] = '\0';
-            
-            if (strncmp(buffer, "EXIT", 4) == 0) {
+        int count = reader.readFrom(fd, records, 8);
+        if (count < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        int64_t receivedNs = avnClockNs();
+        fromAVN.add(count, sizeof(AVN));
+        for (int i = 0; i < count; i++) {
+            const AVN &newAVN = records[i];
+            if (!avnValid(newAVN)) continue;
+
+            if (newAVN.messageType == AVN_MSG_EXIT) {
                 cout << "Received exit signal. Shutting down..." << endl;
                 running = false;
                 return;
                 break;
                 
             }
-
-            AVN newAVN = parseAVN(buffer);
+            // Payment updates are re-sends of an old notice; only first arrivals count
+            if (!newAVN.isPaid)
+                receiptLatency.record(newAVN.aircraftType, newAVN.flags & AVN_FLAG_EMERGENCY,
+                                      receivedNs - newAVN.generatedNs);
 
             {
                 std::lock_guard<std::mutex> lock(dataMutex);
@@ -165,8 +117,6 @@ void listenForAVNs() {
                 cout << "Enter flight name to pay  ";
                 cout.flush();
             }
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
     }
 
@@ -197,6 +147,7 @@ void processPayment(const string& flightName) {
 
     // Simulate payment processing
     avnToPay.isPaid = true;
+    paymentsMade.add();
     cout << "Payment successful for flight: " << flightName << endl;
 
     // Update and send payment status
@@ -234,6 +185,20 @@ void handleUserInput() {
 int main() {
     createPipesIfNotExist();
     cout << "StripePay Process Started" << endl;
+    LatencyReporter latency("stripepay");
+    latency.add("avn_stripe_receipt", "", &receiptLatency);
+    latency.start();
+    fromAVN.registerAs(metrics, "stripepay", "avn_to_stripe", false);
+    toAVN.registerAs(metrics, "stripepay", "stripe_to_avn", true);
+    toPortal.registerAs(metrics, "stripepay", "stripe_to_portal", true);
+    metrics.counter("stripepay_payments_total", "Fines paid", "", paymentsMade);
+    metrics.gauge("stripepay_unpaid_avns", "Flights with an unpaid violation notice", "", []() {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        int unpaid = 0;
+        for (const auto &entry : avnMap) unpaid += !entry.second.isPaid;
+        return (double)unpaid;
+    });
+    metrics.startExport("stripepay");
 
     // Start threads
     std::thread avnListenerThread(listenForAVNs);
@@ -242,6 +207,8 @@ int main() {
     // Wait for threads to finish
     avnListenerThread.join();
     inputThread.join();
+    latency.stop();
+    metrics.stopExport();
 
     // Clean up pipes
     unlink(AVN_TO_STRIPE_PIPE);